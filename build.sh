@@ -28,28 +28,152 @@ echo -e "\e[32mfound\e[0m"
 mkdir -p target
 mkdir -p game_files
 
-CFLAGS="-std=c23 -Wall -Werror -lncurses"
+CFLAGS="-std=c23 -Wall -Werror -pthread"
+LIBS="-lncurses" # only the tui links against ncurses
+STATIC_LIBS=$(pkg-config --static --libs ncurses 2> /dev/null || echo "-lncurses -ltinfo")
+WRAP="-Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc" # counts allocations in the benchmarks
+LIB="target/libunivoid.a"
 RELEASE="target/uni-void"
 DEBUG="target/debug"
+BENCH="target/bench"
+
+# lto objects can only be archived by an ar that knows about them.
+if [ $CC = clang ] && command -v llvm-ar > ./tmp; then
+  AR=llvm-ar
+elif [ $CC = gcc ] && command -v gcc-ar > ./tmp; then
+  AR=gcc-ar
+else
+  AR=ar
+fi
+
+# builds the game core into a static library (see src/libunivoid.h) and
+# links the game and the benchmarks against it, all into target/build/<profile>/
+# usage: build_profile <profile> <compile flags> <link flags> <tui libs>
+build_profile() {
+  local dir="target/build/$1"
+  mkdir -p $dir
+  $CC $CFLAGS $2 -c src/libunivoid.c -o $dir/libunivoid.o &&
+  $AR rcs $dir/libunivoid.a $dir/libunivoid.o &&
+  $CC $CFLAGS $2 src/main.c $dir/libunivoid.a -o $dir/uni-void $3 $4 &&
+  $CC $CFLAGS $2 src/bench.c $dir/libunivoid.a -o $dir/bench $3 $WRAP
+}
 
 compile_debug() {
   echo -e "compiling in \e[32mdebug mode\e[0m..."
-  $CC $CFLAGS -g src/main.c -o $DEBUG
+  build_profile debug "-g" "" "$LIBS" && cp target/build/debug/uni-void $DEBUG
 }
 
+# portable: runs on any cpu of the target architecture.
 compile_release() {
   echo -e "compiling in \e[32mrelease mode\e[0m..."
-  $CC $CFLAGS -O3 src/main.c -o $RELEASE
+  build_profile release "-O3 -flto=auto" "" "$LIBS" &&
+  cp target/build/release/uni-void $RELEASE &&
+  cp target/build/release/libunivoid.a $LIB
+}
+
+# tuned for the cpu it is built on, the binary may not run anywhere else.
+compile_native() {
+  echo -e "compiling in \e[32mnative mode\e[0m..."
+  build_profile native "-O3 -flto=auto -march=native" "" "$LIBS" && cp target/build/native/uni-void $RELEASE-native
+}
+
+# the headless workload the pgo build is trained on. the game itself is
+# interactive, but every move, deal and solve goes through these.
+pgo_train() {
+  local dir="target/build/pgo"
+  ./$dir/bench 200000 1 > /dev/null &&
+  ./$dir/uni-void gen-bench 200 1 1 > /dev/null &&
+  ./$dir/uni-void wd-bench 2 1 > /dev/null &&
+  ./$dir/uni-void solve-bench 4 2 60 1 > /dev/null &&
+  ./$dir/uni-void reduce-bench 8 20 > /dev/null
+  ./$dir/uni-void verify > /dev/null # mismatches are fine for training
+  return 0
+}
+
+# two stages: an instrumented build is run on pgo_train, then everything is
+# rebuilt with the recorded profile. both stages have to build into the same
+# place, gcc finds the profile of an object by its path.
+compile_pgo() {
+  echo -e "compiling in \e[32mpgo mode\e[0m..."
+  local data="$PWD/target/build/pgo-data"
+  rm -rf $data
+  mkdir -p $data
+  if [ $CC = clang ]; then
+    build_profile pgo "-O3 -flto=auto -fprofile-generate=$data" "" "$LIBS" || return 1
+    echo "training..."
+    LLVM_PROFILE_FILE="$data/%p.profraw" pgo_train &&
+    llvm-profdata merge -o $data/uni-void.profdata $data/*.profraw &&
+    build_profile pgo "-O3 -flto=auto -fprofile-use=$data/uni-void.profdata" "" "$LIBS"
+  else
+    build_profile pgo "-O3 -flto=auto -fprofile-generate -fprofile-dir=$data" "" "$LIBS" || return 1
+    echo "training..."
+    pgo_train &&
+    build_profile pgo "-O3 -flto=auto -fprofile-use -fprofile-dir=$data" "" "$LIBS"
+  fi && cp target/build/pgo/uni-void $RELEASE-pgo
+}
+
+# for minimal containers: no shared libraries needed at all.
+compile_small() {
+  echo -e "compiling in \e[32msmall mode\e[0m..."
+  build_profile small "-Os -flto=auto -ffunction-sections -fdata-sections" "-static -s -Wl,--gc-sections" "$STATIC_LIBS" &&
+  cp target/build/small/uni-void $RELEASE-small
+}
+
+# builds every optimized profile and compares binary size and benchmarks.
+# bench columns are ns per op on 4x4 boards, total is the sum over all rows.
+report() {
+  local ops=${1:-200000}
+  compile_release && compile_native && compile_pgo && compile_small || return 1
+  echo "running benchmarks of every profile ($ops ops each)..."
+  echo "profile,binary_bytes,mov_zero,move_and_record,push_pop_key,is_sorted,is_solvable,populate_mat,total" > target/profiles.csv
+  for profile in release native pgo small; do
+    local dir="target/build/$profile"
+    ./$dir/bench $ops 1 > $dir/bench.csv || return 1
+    awk -F, -v profile=$profile -v bytes=$(stat -c %s $dir/uni-void) '
+      NR > 1 { total += $4 }
+      NR > 1 && $2 == 4 { ns[$1] = $4 }
+      END {
+        printf "%s,%d,%s,%s,%s,%s,%s,%s,%.2f\n", profile, bytes, ns["mov_zero"], ns["move_and_record"],
+               ns["push_pop_key"], ns["mov_zero+is_sorted"], ns["is_solvable"], ns["populate_mat"], total
+      }' $dir/bench.csv >> target/profiles.csv
+  done
+  column -s, -t target/profiles.csv 2> /dev/null || cat target/profiles.csv
 }
 
 case $1 in
   "debug")
-    compile_debug
+    compile_debug || exit 1
     BIN=$DEBUG
     ;;
   "release")
     BIN=$RELEASE
-    compile_release
+    compile_release || exit 1
+    ;;
+  "native")
+    BIN=$RELEASE-native
+    compile_native || exit 1
+    ;;
+  "pgo")
+    BIN=$RELEASE-pgo
+    compile_pgo || exit 1
+    ;;
+  "small")
+    BIN=$RELEASE-small
+    compile_small || exit 1
+    ;;
+  "bench") # ./build.sh bench [ops per benchmark] [seed]
+    echo -e "compiling \e[32mbenchmarks\e[0m..."
+    compile_release || exit 1
+    cp target/build/release/bench $BENCH
+    echo "running benchmarks, results go to target/bench.csv..."
+    ./$BENCH "${@:2}" | tee target/bench.csv
+    rm ./tmp
+    exit
+    ;;
+  "report") # ./build.sh report [ops per benchmark]
+    report $2
+    rm ./tmp
+    exit
     ;;
   *)
     compile_debug
@@ -1,12 +1,11 @@
 #pragma once
 
-#include <ncurses.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <time.h>
-#include "arena.c"
 
 // file for storing leaderboard info
 #define LEADERBOARD_FILE "game_files/leaderboard.csv"
@@ -14,19 +13,44 @@
 // location for serializing game state.
 #define STATE_FILE "game_files/game_state.bin"
 
+// replays of finished games, one file per leaderboard row.
+#define REPLAY_DIR "game_files/replays"
+
+// cache of the walking distance tables used by the 4x4 solver.
+#define WALKING_DISTANCE_FILE "game_files/walking_distance.bin"
+
+// distances of every 3x3 board, see src/state_space.c
+#define DISTANCE_TABLE_FILE "game_files/distance3.bin"
+
+// optimal solutions found so far, see src/solution_cache.c
+#define SOLUTION_CACHE_FILE "game_files/solutions.bin"
+
 // size of stack
 #define STK_SIZE 60 
 
-// these macros evaluate mid point of stdscr based on given offset
-#define CENTER_Y(offset) (((LINES - (offset)) / 2))
-#define CENTER_X(offset) (((COLS - (offset)) / 2))
-
 // used to adjust the order of matrix based on the selected game mode
 #define MODE_OFFSET 2
 
-// defines maximum moves for hard mode
+// largest board of a custom game. boards that don't fit the terminal are
+// scrolled to follow the void-tile, hints stop at HINT_MAX_ORDER.
+#define CUSTOM_MAX_ORDER 100
+
+// defines maximum moves for hard mode. games get a budget computed from a
+// solver instead (see move_budget()), this is left for older saves.
 #define HARD_MODE_MOVE_LIMIT 300
 
+// extra moves over the solver's solution, in percent
+#define HARD_MODE_SLACK 50
+
+// delay between moves while auto-play is on. also how often
+// a pending hint is checked for.
+#define AUTOPLAY_DELAY_MS 150
+
+// a slide of several tiles at once (a count before a move, "5l") is a
+// single key: the direction with the number of tiles in the bits from
+// KEY_SLIDE_SHIFT up, so key * -1 is still the inverse. see slide_key().
+#define KEY_SLIDE_SHIFT 8
+
 typedef enum {
   key_invalid,
   key_up = 1,
@@ -40,6 +64,12 @@ typedef enum {
   key_resize,
   key_usage,
   key_force_quit,
+  key_hint,
+  key_autoplay,
+  key_stats,
+  key_step_back, // one step back on the timeline, see timeline.c
+  key_step_forward,
+  key_jump, // to a step of the timeline
 } Key;
 
 typedef enum {
@@ -57,53 +87,20 @@ typedef enum {
   count_down, // indicate decrement move counter
 } Counter;
 
-struct status_line {
-  size_t moves;
-  char *msg;
-  Key key;
-};
-
 struct game_state {
   uint16_t order; // order of square matrix
   uint16_t mode; // easy, normal, hard modes
   uint16_t curs_x; // x-coordinate of void-tile
   uint16_t curs_y; // y-coordinate of void-tile
   uint16_t moves; // moves counter
+  uint16_t move_limit; // moves available in hard mode
   Counter count_ctrl; // specify to use an up-counter or a down-counter
   int16_t utop; // stack pointers
   int16_t rtop;
   Key undo_stack[STK_SIZE];
   Key redo_stack[STK_SIZE];
+  uint64_t hash; // zobrist hash of mat, kept up to date by mov_zero()
   int** mat; // our puzzle matrix
+  int* tiles; // the same matrix as one array, mat[i] points to row i of it
+  const struct board_kernel* kernel; // moves and checks for this order, see src/kernels.c
 };
-// initialize game_state data type.
-struct game_state game_state_init(Arena* arena, int order) {
-  struct game_state gs = {
-    .order = order,
-    .mode = order - MODE_OFFSET,
-    // since easy mode represents order 3 and index of easy mode
-    // is 1, easy mode = order - 2 (2 is the MODE_OFFSET).
-    .curs_x = -1,
-    .curs_y = -1,
-    .moves = 0,
-    .count_ctrl = count_stop,
-    .mat = arena_alloc(arena, sizeof(int*) * order),
-    // these are stack pointers for undo(utop) and redo(rtop) stacks.
-    .utop = -1,
-    .rtop = -1,
-  };
-  for (int i = 0; i < order; i++) {
-    gs.mat[i] = arena_alloc(arena, sizeof(int) * order);
-  }
-  return gs;
-}
-
-// initialize status line with given message.
-struct status_line status_line_init(char* msg) {
-  return (struct status_line) {
-    .moves = 0,
-    .key = 0,
-    .msg = msg
-  };
-}
-
@@ -0,0 +1,256 @@
+/*
+Statistics of the leaderboard: `uni-void stats [file] [json|csv]`.
+
+The leaderboard file of the game only keeps a few rows, but files merged
+from many players and machines can run into gigabytes. They are read in
+a single pass with stream_leaderboard() and nothing but the aggregates
+below is kept:
+
+  - per order : games, min, max and mean moves, percentiles of the moves
+                and the games finished in every hour of the day (local
+                time). moves are counted into a log-linear histogram with
+                32 buckets for every power of two, so percentiles are
+                exact below 32 moves and off by at most 3% above, and an
+                order takes the same few KB however many games it has.
+  - per player : best game of every player on every order, in a hash
+                 table. this is the only part that grows, with the number
+                 of distinct players.
+
+Orders outside 2 to CUSTOM_MAX_ORDER are counted as skipped. Best means
+fewest moves on every order, rows keep the moves used even in hard mode
+(see moves_used()).
+
+json is one object with an entry per order, csv is a long table:
+  "Order","Stat","Key","Value"
+*/
+
+#pragma once
+
+#include <fcntl.h>
+#include "libunivoid.h"
+#include "leaderboard.c"
+
+#define ANALYTICS_SUB_BUCKETS 32 // buckets per power of two
+#define ANALYTICS_BUCKETS (12 * ANALYTICS_SUB_BUCKETS) // moves are uint16
+
+// percentiles reported for every order.
+static const double analytics_percentiles[] = { 50, 90, 99 };
+
+struct order_stats {
+  uint64_t count;
+  uint64_t sum;
+  uint16_t min, max;
+  uint64_t hist[ANALYTICS_BUCKETS];
+  uint64_t hours[24];
+  uint32_t players;
+};
+
+struct player_best {
+  uint16_t order; // 0 for a free slot
+  uint16_t moves;
+  uint32_t games;
+  int64_t time; // of the best game
+  char name[LEADERBOARD_NAME_MAX];
+};
+
+struct analytics {
+  struct order_stats* orders[CUSTOM_MAX_ORDER + 1]; // NULL until a record of the order shows up
+  struct player_best* players; // open addressing, capacity is a power of two
+  uint64_t capacity;
+  uint64_t n_players;
+  uint64_t skipped; // records of orders that aren't kept
+  bool failed; // out of memory
+};
+
+static int analytics_bucket(uint16_t moves) {
+  if (moves < ANALYTICS_SUB_BUCKETS) return moves;
+  int exp = 31 - __builtin_clz(moves); // at least 5
+  return (exp - 4) * ANALYTICS_SUB_BUCKETS + ((moves >> (exp - 5)) & (ANALYTICS_SUB_BUCKETS - 1));
+}
+
+// smallest value that falls into bucket.
+static uint32_t analytics_bucket_low(int bucket) {
+  if (bucket < ANALYTICS_SUB_BUCKETS) return bucket;
+  int exp = bucket / ANALYTICS_SUB_BUCKETS + 4;
+  return (uint32_t)(ANALYTICS_SUB_BUCKETS + bucket % ANALYTICS_SUB_BUCKETS) << (exp - 5);
+}
+
+static uint16_t analytics_percentile(const struct order_stats* os, double percent) {
+  uint64_t rank = os->count * percent / 100, seen = 0;
+  for (int b = 0; b < ANALYTICS_BUCKETS; b++) {
+    seen += os->hist[b];
+    if (seen > rank) {
+      uint32_t low = analytics_bucket_low(b);
+      return (low < os->min) ? os->min : (low > os->max) ? os->max : low;
+    }
+  }
+  return os->max;
+}
+
+static uint64_t analytics_hash(uint16_t order, const char* name) {
+  uint64_t hash = 0xcbf29ce484222325ULL ^ order; // fnv-1a
+  for (; *name; name++) hash = (hash ^ (uint8_t)*name) * 0x100000001b3ULL;
+  return hash;
+}
+
+// slot of the player on order, or the free slot it would take.
+static struct player_best* analytics_slot(struct player_best* table, uint64_t capacity, uint16_t order, const char* name) {
+  uint64_t i = analytics_hash(order, name) & (capacity - 1);
+  while (table[i].order != 0 && (table[i].order != order || strcmp(table[i].name, name) != 0)) {
+    i = (i + 1) & (capacity - 1);
+  }
+  return &table[i];
+}
+
+static bool analytics_grow(struct analytics* a) {
+  uint64_t capacity = (a->capacity == 0) ? 1024 : a->capacity * 2;
+  struct player_best* table = calloc(capacity, sizeof(struct player_best));
+  if (table == NULL) return false;
+  for (uint64_t i = 0; i < a->capacity; i++) {
+    if (a->players[i].order != 0) *analytics_slot(table, capacity, a->players[i].order, a->players[i].name) = a->players[i];
+  }
+  free(a->players);
+  a->players = table;
+  a->capacity = capacity;
+  return true;
+}
+
+static void analytics_visit(const struct leaderboard_record* record, void* ctx) {
+  struct analytics* a = ctx;
+  if (a->failed) return;
+  if (record->order < 2 || record->order > CUSTOM_MAX_ORDER) {
+    a->skipped++;
+    return;
+  }
+  if (a->orders[record->order] == NULL) {
+    if ((a->orders[record->order] = calloc(1, sizeof(struct order_stats))) == NULL) {
+      a->failed = true;
+      return;
+    }
+    a->orders[record->order]->min = UINT16_MAX;
+  }
+  struct order_stats* os = a->orders[record->order];
+  os->count++;
+  os->sum += record->moves;
+  if (record->moves < os->min) os->min = record->moves;
+  if (record->moves > os->max) os->max = record->moves;
+  os->hist[analytics_bucket(record->moves)]++;
+  struct tm tm;
+  time_t t = record->time;
+  if (localtime_r(&t, &tm) != NULL) os->hours[tm.tm_hour]++;
+
+  if (a->n_players * 10 >= a->capacity * 7 && !analytics_grow(a)) {
+    a->failed = true;
+    return;
+  }
+  struct player_best* p = analytics_slot(a->players, a->capacity, record->order, record->player_name);
+  if (p->order == 0) {
+    *p = (struct player_best) { .order = record->order, .moves = record->moves, .time = record->time };
+    strcpy(p->name, record->player_name);
+    a->n_players++;
+    os->players++;
+  } else if (record->moves < p->moves) {
+    p->moves = record->moves;
+    p->time = record->time;
+  }
+  p->games++;
+}
+
+static int compare_players(const void* a, const void* b) {
+  const struct player_best* x = *(struct player_best* const*)a;
+  const struct player_best* y = *(struct player_best* const*)b;
+  if (x->moves != y->moves) return (x->moves < y->moves) ? -1 : 1;
+  return (x->time > y->time) - (x->time < y->time); // the first one to get there
+}
+
+// players of order, best first. the caller frees the array.
+static struct player_best** analytics_players(const struct analytics* a, uint16_t order) {
+  struct player_best** list = malloc(sizeof(struct player_best*) * (a->orders[order]->players + 1));
+  if (list == NULL) return NULL;
+  uint32_t n = 0;
+  for (uint64_t i = 0; i < a->capacity; i++) {
+    if (a->players[i].order == order) list[n++] = &a->players[i];
+  }
+  qsort(list, n, sizeof(struct player_best*), compare_players);
+  return list;
+}
+
+// prints s as the contents of a json or csv string.
+static void print_escaped(const char* s, bool json) {
+  for (; *s; s++) {
+    if (json && (*s == '"' || *s == '\\')) printf("\\%c", *s);
+    else if (json && (uint8_t)*s < 0x20) printf("\\u%04x", *s);
+    else if (!json && *s == '"') printf("\"\"");
+    else putchar(*s);
+  }
+}
+
+static void analytics_print_json(const struct analytics* a, uint64_t records, uint64_t skipped) {
+  printf("{\n  \"records\": %lu,\n  \"skipped\": %lu,\n  \"orders\": [", records, skipped);
+  bool first = true;
+  for (int order = 2; order <= CUSTOM_MAX_ORDER; order++) {
+    const struct order_stats* os = a->orders[order];
+    if (os == NULL) continue;
+    printf("%s\n    {\n      \"order\": %d,\n      \"games\": %lu,\n", first ? "" : ",", order, os->count);
+    printf("      \"moves\": { \"min\": %u, \"max\": %u, \"mean\": %.2f", os->min, os->max, (double)os->sum / os->count);
+    for (size_t i = 0; i < sizeof(analytics_percentiles) / sizeof(double); i++) {
+      printf(", \"p%g\": %u", analytics_percentiles[i], analytics_percentile(os, analytics_percentiles[i]));
+    }
+    printf(" },\n      \"hours\": [");
+    for (int h = 0; h < 24; h++) printf("%s%lu", h ? ", " : "", os->hours[h]);
+    printf("],\n      \"players\": [");
+    struct player_best** players = analytics_players(a, order);
+    for (uint32_t i = 0; players && i < os->players; i++) {
+      printf("%s\n        { \"player\": \"", i ? "," : "");
+      print_escaped(players[i]->name, true);
+      printf("\", \"best\": %u, \"time\": %ld, \"games\": %u }", players[i]->moves, players[i]->time, players[i]->games);
+    }
+    free(players);
+    printf("\n      ]\n    }");
+    first = false;
+  }
+  printf("\n  ]\n}\n");
+}
+
+static void analytics_print_csv(const struct analytics* a, uint64_t records, uint64_t skipped) {
+  printf("\"Order\",\"Stat\",\"Key\",\"Value\"\n");
+  printf(",records,,%lu\n,skipped,,%lu\n", records, skipped);
+  for (int order = 2; order <= CUSTOM_MAX_ORDER; order++) {
+    const struct order_stats* os = a->orders[order];
+    if (os == NULL) continue;
+    printf("%d,games,,%lu\n%d,min,,%u\n%d,max,,%u\n%d,mean,,%.2f\n", order, os->count, order, os->min, order, os->max, order, (double)os->sum / os->count);
+    for (size_t i = 0; i < sizeof(analytics_percentiles) / sizeof(double); i++) {
+      printf("%d,p%g,,%u\n", order, analytics_percentiles[i], analytics_percentile(os, analytics_percentiles[i]));
+    }
+    for (int h = 0; h < 24; h++) printf("%d,hour,%d,%lu\n", order, h, os->hours[h]);
+    struct player_best** players = analytics_players(a, order);
+    for (uint32_t i = 0; players && i < os->players; i++) {
+      printf("%d,best,\"", order);
+      print_escaped(players[i]->name, false);
+      printf("\",%u\n", players[i]->moves);
+    }
+    free(players);
+  }
+}
+
+// prints the statistics of the leaderboard csv at path ("-" for stdin) as
+// json or csv. returns false if that didn't work out.
+bool leaderboard_stats(const char* path, bool json) {
+  FILE* fp = (strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+  if (fp == NULL) return false;
+  posix_fadvise(fileno(fp), 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  struct analytics a = { 0 };
+  uint64_t skipped, records = stream_leaderboard(fp, analytics_visit, &a, &skipped);
+  bool ok = !ferror(fp);
+  if (fp != stdin) fclose(fp);
+  if (a.failed) fprintf(stderr, "stats: out of memory\n");
+  if (ok && !a.failed) {
+    if (json) analytics_print_json(&a, records - a.skipped, skipped + a.skipped);
+    else analytics_print_csv(&a, records - a.skipped, skipped + a.skipped);
+  }
+
+  for (int order = 0; order <= CUSTOM_MAX_ORDER; order++) free(a.orders[order]);
+  free(a.players);
+  return ok && !a.failed;
+}
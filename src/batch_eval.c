@@ -0,0 +1,182 @@
+/*
+Heuristics of many boards at once.
+
+The solvers look at one board at a time and update its heuristic move by
+move. Rating, generating and checking boards in bulk wants the manhattan
+distance and the linear conflicts of thousands of unrelated boards
+instead, so struct board_batch keeps them as a structure of arrays: the
+tiles of cell c of every board sit next to each other,
+
+  tiles[c * capacity + board]
+
+and one pass over the cells works on BATCH_LANES boards side by side.
+Tiles are bytes, the sums are 16 bit, which covers boards up to
+BATCH_MAX_ORDER.
+
+  - board_batch_eval() : AVX2, 16 boards per instruction. picked at run
+                         time, so the portable builds use it too.
+  - board_batch_eval_scalar() : one board at a time, for cpus without
+                         AVX2 (and for checking the former).
+
+Both give exactly what search_eval() of solver.c gives for the solved
+goal: md is the sum of manhattan distances, lc the sum of line conflicts
+(tiles that have to leave a line so that the rest of it is in goal order,
+see line_conflicts()). The heuristic is md + 2 * lc.
+*/
+
+#pragma once
+
+#include "libunivoid.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BATCH_AVX2
+#endif
+
+// lanes of a vector, capacity is rounded up to a multiple of it.
+#define BATCH_LANES 16
+
+bool board_batch_init(struct board_batch* b, int order, uint32_t capacity) {
+  *b = (struct board_batch) { .order = order };
+  if (order < 2 || order > BATCH_MAX_ORDER) return false;
+  capacity = (capacity + BATCH_LANES - 1) / BATCH_LANES * BATCH_LANES;
+  if (capacity == 0) capacity = BATCH_LANES;
+  // the padding boards are all zeros, which costs nothing and adds up to 0.
+  b->tiles = calloc((size_t)order * order * capacity, sizeof(uint8_t));
+  b->md = calloc(capacity, sizeof(uint16_t));
+  b->lc = calloc(capacity, sizeof(uint16_t));
+  if (b->tiles == NULL || b->md == NULL || b->lc == NULL) {
+    board_batch_free(b);
+    return false;
+  }
+  b->capacity = capacity;
+  return true;
+}
+
+void board_batch_free(struct board_batch* b) {
+  free(b->tiles);
+  free(b->md);
+  free(b->lc);
+  *b = (struct board_batch) { 0 };
+}
+
+// appends a board given in reading order. returns false when the batch is full.
+bool board_batch_add(struct board_batch* b, const uint8_t* tiles) {
+  if (b->count == b->capacity) return false;
+  for (int c = 0; c < b->order * b->order; c++) b->tiles[c * b->capacity + b->count] = tiles[c];
+  b->count++;
+  return true;
+}
+
+void board_batch_eval_scalar(struct board_batch* b) {
+  int order = b->order, size = order * order;
+  for (uint32_t i = 0; i < b->count; i++) {
+    int md = 0, lc = 0;
+    for (int c = 0; c < size; c++) {
+      int tile = b->tiles[c * b->capacity + i];
+      if (tile == 0) continue;
+      md += abs(c / order - (tile - 1) / order) + abs(c % order - (tile - 1) % order);
+    }
+    // rows, then columns. seq holds the goal positions of the tiles that
+    // belong to the line, lis the longest increasing run ending at each.
+    for (int line = 0; line < order * 2; line++) {
+      bool is_row = line < order;
+      int k = is_row ? line : line - order, seq[BATCH_MAX_ORDER], lis[BATCH_MAX_ORDER], len = 0, longest = 0;
+      for (int j = 0; j < order; j++) {
+        int tile = b->tiles[(is_row ? k * order + j : j * order + k) * b->capacity + i];
+        if (tile == 0) continue;
+        int row = (tile - 1) / order, col = (tile - 1) % order;
+        if (is_row && row == k) seq[len++] = col;
+        else if (!is_row && col == k) seq[len++] = row;
+      }
+      for (int j = 0; j < len; j++) {
+        lis[j] = 1;
+        for (int l = 0; l < j; l++) {
+          if (seq[l] < seq[j] && lis[l] + 1 > lis[j]) lis[j] = lis[l] + 1;
+        }
+        if (lis[j] > longest) longest = lis[j];
+      }
+      lc += len - longest;
+    }
+    b->md[i] = md;
+    b->lc[i] = lc;
+  }
+}
+
+#ifdef BATCH_AVX2
+
+// tiles of cell c for the 16 boards starting at board i, widened to 16 bits.
+__attribute__((target("avx2")))
+static inline __m256i batch_load(const struct board_batch* b, int c, uint32_t i) {
+  return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)&b->tiles[(size_t)c * b->capacity + i]));
+}
+
+// the same as board_batch_eval_scalar(), branch free across the lanes.
+// goal row and column of a tile t are (t - 1) / order and (t - 1) % order,
+// the division is a multiply by ceil(65536 / order) keeping the high half,
+// which is exact for tiles below 256.
+__attribute__((target("avx2")))
+static void board_batch_eval_avx2(struct board_batch* b) {
+  int order = b->order;
+  const __m256i one = _mm256_set1_epi16(1), zero = _mm256_setzero_si256();
+  const __m256i magic = _mm256_set1_epi16((uint16_t)(65536 / order + 1)), n = _mm256_set1_epi16(order);
+
+  for (uint32_t i = 0; i < b->count; i += BATCH_LANES) {
+    __m256i md = zero, lc = zero;
+    __m256i rows[BATCH_MAX_ORDER * BATCH_MAX_ORDER], cols[BATCH_MAX_ORDER * BATCH_MAX_ORDER], empty[BATCH_MAX_ORDER * BATCH_MAX_ORDER];
+    for (int c = 0; c < order * order; c++) {
+      __m256i t = batch_load(b, c, i);
+      __m256i goal = _mm256_sub_epi16(t, one);
+      rows[c] = _mm256_mulhi_epu16(goal, magic);
+      cols[c] = _mm256_sub_epi16(goal, _mm256_mullo_epi16(rows[c], n));
+      empty[c] = _mm256_cmpeq_epi16(t, zero);
+      __m256i d = _mm256_add_epi16(_mm256_abs_epi16(_mm256_sub_epi16(rows[c], _mm256_set1_epi16(c / order))),
+                                   _mm256_abs_epi16(_mm256_sub_epi16(cols[c], _mm256_set1_epi16(c % order))));
+      md = _mm256_add_epi16(md, _mm256_andnot_si256(empty[c], d));
+    }
+    for (int line = 0; line < order * 2; line++) {
+      bool is_row = line < order;
+      int k = is_row ? line : line - order;
+      __m256i len = zero, longest = zero, seq[BATCH_MAX_ORDER], lis[BATCH_MAX_ORDER];
+      const __m256i line_k = _mm256_set1_epi16(k);
+      for (int j = 0; j < order; j++) {
+        int c = is_row ? k * order + j : j * order + k;
+        // lis is 0 for tiles that don't belong to the line, so they never
+        // extend a run. goal positions are small, signed compares are fine.
+        __m256i in = _mm256_andnot_si256(empty[c], _mm256_cmpeq_epi16(is_row ? rows[c] : cols[c], line_k));
+        seq[j] = is_row ? cols[c] : rows[c];
+        __m256i best = zero;
+        for (int l = 0; l < j; l++) {
+          best = _mm256_max_epi16(best, _mm256_and_si256(_mm256_cmpgt_epi16(seq[j], seq[l]), lis[l]));
+        }
+        lis[j] = _mm256_and_si256(in, _mm256_add_epi16(best, one));
+        longest = _mm256_max_epi16(longest, lis[j]);
+        len = _mm256_sub_epi16(len, in); // in is -1 on tiles of the line
+      }
+      lc = _mm256_add_epi16(lc, _mm256_sub_epi16(len, longest));
+    }
+    _mm256_storeu_si256((__m256i*)&b->md[i], md);
+    _mm256_storeu_si256((__m256i*)&b->lc[i], lc);
+  }
+}
+
+#endif
+
+// "avx2" or "scalar", whichever board_batch_eval() runs on this cpu.
+const char* board_batch_isa() {
+#ifdef BATCH_AVX2
+  if (__builtin_cpu_supports("avx2")) return "avx2";
+#endif
+  return "scalar";
+}
+
+// fills md and lc of every board in the batch.
+void board_batch_eval(struct board_batch* b) {
+#ifdef BATCH_AVX2
+  if (__builtin_cpu_supports("avx2")) {
+    board_batch_eval_avx2(b);
+    return;
+  }
+#endif
+  board_batch_eval_scalar(b);
+}
@@ -0,0 +1,214 @@
+/*
+Benchmarks of the game core, built and run by `./build.sh bench`.
+
+Every benchmark drives one core function with a randomized workload on
+boards of order 2 to 16. Inputs (move sequences, arrays) are generated up
+front so that rand() isn't part of what is measured.
+
+malloc and friends are wrapped at link time (-Wl,--wrap=malloc, ...), so
+every allocation made while a benchmark runs is counted, the ones made
+inside libunivoid.a included.
+
+Results are printed as csv, one line per benchmark and order:
+  name,order,ops,ns_per_op,allocs_per_op
+
+  target/bench [ops per benchmark] [seed]
+*/
+
+#include "libunivoid.h"
+
+#define BENCH_MIN_ORDER 2
+#define BENCH_MAX_ORDER 16
+#define BENCH_SEQUENCE 4096 // length of a pregenerated input sequence
+
+static uint64_t allocations;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) { allocations++; return __real_malloc(size); }
+void* __wrap_calloc(size_t n, size_t size) { allocations++; return __real_calloc(n, size); }
+void* __wrap_realloc(void* ptr, size_t size) { allocations++; return __real_realloc(ptr, size); }
+
+// results are written here so the compiler can't drop the work.
+static volatile uint64_t sink;
+
+struct bench_run {
+  double start;
+  uint64_t allocations;
+};
+
+static struct bench_run bench_begin() {
+  return (struct bench_run) { monotonic_seconds(), allocations };
+}
+
+static void bench_end(struct bench_run run, const char* name, int order, uint64_t ops) {
+  double elapsed = monotonic_seconds() - run.start;
+  printf("%s,%d,%lu,%.2f,%.4f\n", name, order, ops, elapsed * 1e9 / ops, (double)(allocations - run.allocations) / ops);
+}
+
+// random moves of the void-tile, including ones that bump into the edges.
+static void random_keys(Key* keys, int n) {
+  static const Key moves[] = { key_up, key_down, key_left, key_right };
+  for (int i = 0; i < n; i++) keys[i] = moves[rand() % 4];
+}
+
+static void bench_mov_zero(struct game_state* gs, const Key* keys, uint64_t ops) {
+  uint64_t moved = 0;
+  struct bench_run run = bench_begin();
+  for (uint64_t i = 0; i < ops; i++) moved += mov_zero(gs, keys[i % BENCH_SEQUENCE]) != count_stop;
+  bench_end(run, "mov_zero", gs->order, ops);
+  sink = moved;
+}
+
+// a move as the game loop makes it: move, push the inverse, count it.
+static void bench_move_and_record(struct game_state* gs, const Key* keys, uint64_t ops) {
+  struct bench_run run = bench_begin();
+  for (uint64_t i = 0; i < ops; i++) {
+    Key key = keys[i % BENCH_SEQUENCE];
+    if (mov_zero(gs, key) == count_stop) continue;
+    push_key(gs->undo_stack, &gs->utop, key * -1);
+    update_moves(gs, key);
+  }
+  bench_end(run, "move_and_record", gs->order, ops);
+  sink = gs->moves;
+}
+
+// undo and redo in random bursts, the way a player fumbling around would.
+static void bench_undo_redo(struct game_state* gs, const Key* keys, uint64_t ops) {
+  struct bench_run run = bench_begin();
+  for (uint64_t i = 0; i < ops; i++) {
+    Key key = keys[i % BENCH_SEQUENCE];
+    if (key == key_up || key == key_left) {
+      if ((key = pop_key(gs->undo_stack, &gs->utop)) != key_invalid) push_key(gs->redo_stack, &gs->rtop, key * -1);
+    } else {
+      if ((key = pop_key(gs->redo_stack, &gs->rtop)) != key_invalid) push_key(gs->undo_stack, &gs->utop, key * -1);
+      else push_key(gs->undo_stack, &gs->utop, keys[(i + 1) % BENCH_SEQUENCE]);
+    }
+  }
+  bench_end(run, "push_pop_key", gs->order, ops);
+  sink = gs->utop + gs->rtop;
+}
+
+static void bench_is_sorted(struct game_state* gs, const Key* keys, uint64_t ops) {
+  uint64_t sorted = 0;
+  struct bench_run run = bench_begin();
+  for (uint64_t i = 0; i < ops; i++) {
+    mov_zero(gs, keys[i % BENCH_SEQUENCE]);
+    sorted += is_sorted(gs);
+  }
+  bench_end(run, "mov_zero+is_sorted", gs->order, ops);
+  sink = sorted;
+}
+
+static void bench_manhattan(struct game_state* gs, const Key* keys, uint64_t ops) {
+  uint64_t md = 0;
+  struct bench_run run = bench_begin();
+  for (uint64_t i = 0; i < ops; i++) {
+    mov_zero(gs, keys[i % BENCH_SEQUENCE]);
+    md += game_state_manhattan(gs);
+  }
+  bench_end(run, "mov_zero+manhattan", gs->order, ops);
+  sink = md;
+}
+
+// slides across the whole board, along rows and columns in turn, as one
+// move each (see slide_key()) and as that many single moves.
+static void bench_slide(struct game_state* gs, uint64_t ops) {
+  static const Key dirs[] = { key_left, key_up, key_right, key_down };
+  uint64_t moved = 0;
+  Counter count_ctrl = gs->count_ctrl;
+  gs->count_ctrl = count_up; // mov_zero() returns count_stop at the edge only
+  struct bench_run run = bench_begin();
+  for (uint64_t i = 0; i < ops; i++) moved += mov_zero(gs, slide_clamp(gs, slide_key(dirs[i % 4], gs->order))) != count_stop;
+  bench_end(run, "slide", gs->order, ops);
+  run = bench_begin();
+  for (uint64_t i = 0; i < ops; i++) {
+    while (mov_zero(gs, dirs[i % 4]) != count_stop) moved++;
+  }
+  bench_end(run, "slide_single_moves", gs->order, ops);
+  sink = moved;
+  gs->count_ctrl = count_ctrl;
+}
+
+// orders with a kernel of their own (see kernels.c) are run once more on
+// the generic kernel, which is what they would get otherwise.
+static void bench_generic_kernel(struct game_state* gs, const Key* keys, uint64_t ops) {
+  const struct board_kernel* kernel = gs->kernel;
+  if (kernel == &board_kernel_generic) return;
+  gs->kernel = &board_kernel_generic;
+  uint64_t moved = 0, sorted = 0, md = 0;
+  struct bench_run run = bench_begin();
+  for (uint64_t i = 0; i < ops; i++) moved += mov_zero(gs, keys[i % BENCH_SEQUENCE]) != count_stop;
+  bench_end(run, "mov_zero_generic", gs->order, ops);
+  run = bench_begin();
+  for (uint64_t i = 0; i < ops; i++) {
+    mov_zero(gs, keys[i % BENCH_SEQUENCE]);
+    sorted += is_sorted(gs);
+  }
+  bench_end(run, "mov_zero+is_sorted_generic", gs->order, ops);
+  run = bench_begin();
+  for (uint64_t i = 0; i < ops; i++) {
+    mov_zero(gs, keys[i % BENCH_SEQUENCE]);
+    md += game_state_manhattan(gs);
+  }
+  bench_end(run, "mov_zero+manhattan_generic", gs->order, ops);
+  sink = moved + sorted + md;
+  gs->kernel = kernel;
+}
+
+static void bench_is_solvable(int order, uint64_t ops) {
+  int size = order * order, n_arrays = 64;
+  int* arrays = malloc(sizeof(int) * size * n_arrays);
+  for (int i = 0; i < n_arrays; i++) make_radomized_array(arrays + i * size, size);
+  uint64_t solvable = 0;
+  struct bench_run run = bench_begin();
+  for (uint64_t i = 0; i < ops; i++) solvable += is_solvable(arrays + (i % n_arrays) * size, order);
+  bench_end(run, "is_solvable", order, ops);
+  sink = solvable;
+  free(arrays);
+}
+
+static void bench_populate_mat(struct game_state* gs, uint64_t ops) {
+  struct bench_run run = bench_begin();
+  for (uint64_t i = 0; i < ops; i++) populate_mat(gs);
+  bench_end(run, "populate_mat", gs->order, ops);
+  sink = gs->hash;
+}
+
+int main(int argc, char* argv[]) {
+  uint64_t ops = (argc > 1) ? atol(argv[1]) : 1000000;
+  unsigned seed = (argc > 2) ? atol(argv[2]) : 1;
+  if (ops == 0) {
+    fprintf(stderr, "bench: invalid op count\n");
+    return 1;
+  }
+  srand(seed);
+  Key keys[BENCH_SEQUENCE];
+  random_keys(keys, BENCH_SEQUENCE);
+
+  printf("name,order,ops,ns_per_op,allocs_per_op\n");
+  for (int order = BENCH_MIN_ORDER; order <= BENCH_MAX_ORDER; order++) {
+    Arena* arena = arena_init(1024);
+    if (arena == NULL) return 1;
+    struct game_state gs = game_state_init(arena, order);
+    populate_mat(&gs);
+    // counting up, as deal_game() leaves a normal game. game_state_init()
+    // stops the counter, and mov_zero() then reports every move as count_stop.
+    gs.count_ctrl = count_up;
+
+    bench_mov_zero(&gs, keys, ops);
+    bench_move_and_record(&gs, keys, ops);
+    bench_undo_redo(&gs, keys, ops);
+    bench_is_sorted(&gs, keys, ops);
+    bench_manhattan(&gs, keys, ops);
+    bench_generic_kernel(&gs, keys, ops);
+    bench_slide(&gs, ops / 10 > 0 ? ops / 10 : 1);
+    // these are far slower than a move, fewer runs will do.
+    bench_is_solvable(order, (ops / 10 > 0) ? ops / 10 : 1);
+    bench_populate_mat(&gs, (ops / 100 > 0) ? ops / 100 : 1);
+    arena_free(arena);
+  }
+  return 0;
+}
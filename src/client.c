@@ -0,0 +1,178 @@
+/*
+Thin client of `uni-void serve`: `uni-void --connect [socket]`.
+
+The game itself runs on the server (see server.c). This only sends the
+keys pressed and draws the boards that come back. Keys are sent in the
+same batches the local game loop applies them in: everything pending is
+sent at once and the screen is drawn once, from the reply to the last
+key.
+
+Hints and auto-play need a solver thread per player, so they are only
+available in local games.
+*/
+
+#pragma once
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <ncurses.h>
+#include "libunivoid.h"
+#include "keymaps.c"
+#include "view.c"
+
+struct client {
+  int fd;
+  uint32_t seq; // of the last request sent
+  struct server_reply reply; // the last reply read
+  struct server_record records[LEADERBOARD_ENTRIES]; // of the last leaderboard reply
+};
+
+static bool client_write(int fd, const void* buf, size_t size) {
+  for (size_t done = 0; done < size; ) {
+    ssize_t n = send(fd, (const uint8_t*)buf + done, size - done, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    done += n;
+  }
+  return true;
+}
+
+static bool client_read(int fd, void* buf, size_t size) {
+  for (size_t done = 0; done < size; ) {
+    ssize_t n = recv(fd, (uint8_t*)buf + done, size - done, 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    done += n;
+  }
+  return true;
+}
+
+// returns a socket connected to the server at path, -1 if there is none.
+int client_connect(const char* path) {
+  struct sockaddr_un addr = { .sun_family = AF_UNIX };
+  if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+  strcpy(addr.sun_path, path);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    close(fd);
+    fd = -1;
+  }
+  return fd;
+}
+
+// sends n requests and reads replies until the one for the last of them.
+// boards are copied into view, which must be of the order being played.
+static bool client_send(struct client* c, struct server_request* reqs, int n, struct game_state* view) {
+  for (int i = 0; i < n; i++) reqs[i].seq = ++c->seq;
+  if (!client_write(c->fd, reqs, sizeof(struct server_request) * n)) return false;
+
+  do {
+    if (!client_read(c->fd, &c->reply, sizeof(c->reply))) return false;
+    if (c->reply.type == reply_board) {
+      if (c->reply.order != view->order || c->reply.count != view->order * view->order) return false;
+      uint16_t tiles[c->reply.count + 1];
+      if (!client_read(c->fd, tiles, sizeof(uint16_t) * c->reply.count)) return false;
+      for (int i = 0; i < view->order; i++) {
+        for (int j = 0; j < view->order; j++) view->mat[i][j] = tiles[i * view->order + j];
+      }
+      view->curs_x = c->reply.curs_x;
+      view->curs_y = c->reply.curs_y;
+      view->moves = c->reply.moves;
+    } else if (c->reply.type == reply_leaderboard) {
+      if (c->reply.count > LEADERBOARD_ENTRIES) return false;
+      if (!client_read(c->fd, c->records, sizeof(struct server_record) * c->reply.count)) return false;
+    }
+  } while (c->reply.seq != c->seq);
+  return true;
+}
+
+// puts the won game on the leaderboard of the server and shows it.
+static bool client_leaderboard(struct client* c, struct game_state* view, char* name) {
+  struct server_request req = { .type = req_name };
+  strncpy(req.name, name, SERVER_NAME_MAX - 1);
+  free(name);
+  if (!client_send(c, &req, 1, view) || c->reply.type != reply_leaderboard) return false;
+
+  struct leaderboard_record records[LEADERBOARD_ENTRIES];
+  for (int i = 0; i < c->reply.count; i++) {
+    records[i] = leader_board_init(c->records[i].order, c->records[i].moves, c->records[i].player_name, c->records[i].time);
+  }
+  draw_leaderboard(records, c->reply.count, c->reply.mode, view->order, req.name, c->reply.moves);
+  return true;
+}
+
+// plays a game of mode (and order, for custom games) on the server at path.
+// the message to leave on the status line is put into status.
+void play_remote(const char* path, Mode mode, int order, struct status_line* status) {
+  struct client c = { .fd = client_connect(path) };
+  if (c.fd < 0) {
+    status->msg = "couldn't reach the server! press 'q' to quit";
+    return;
+  }
+  Arena* arena = arena_init(sizeof(int*) * order + sizeof(int) * order * order + 64);
+  if (arena == NULL) {
+    close(c.fd);
+    status->msg = "out of memory! press 'q' to quit";
+    return;
+  }
+  struct game_state view = game_state_init(arena, order);
+  struct server_request reqs[INPUT_BATCH];
+  reqs[0] = (struct server_request) { .type = req_new, .mode = mode, .order = order };
+  bool connected = client_send(&c, reqs, 1, &view) && c.reply.type == reply_board;
+
+  status->msg = "sort the matrix!";
+  Key key = key_invalid;
+  while (connected && key != key_exit) {
+    status->moves = view.moves;
+    update_matrix_view(&view);
+    update_status_line(*status);
+    refresh();
+    if (c.reply.outcome != outcome_playing) break;
+
+    // keys waiting after the first one go out with it.
+    int n = 0;
+    timeout(-1);
+    for (int ch = getch(); ch != ERR && n < INPUT_BATCH; ch = getch()) {
+      timeout(0);
+      key = decode_key(ch);
+      switch (key) {
+        case key_up : case key_down : case key_left : case key_right : case key_undo : case key_redo :
+          reqs[n++] = (struct server_request) { .type = req_key, .key = key };
+          status->key = key;
+          status->msg = "sort the matrix!";
+          break;
+        case key_hint : case key_autoplay :
+          status->msg = "no hints on a server";
+          break;
+        case key_usage :
+          timeout(-1);
+          display_usage();
+          timeout(0);
+          break;
+        case key_force_quit : key = key_exit; break;
+        default : break;
+      }
+      if (key == key_exit) break;
+    }
+    timeout(-1);
+    if (n > 0) connected = client_send(&c, reqs, n, &view);
+  }
+
+  if (!connected) {
+    status->msg = "lost the server! press 'q' to quit";
+  } else if (c.reply.outcome == outcome_won) {
+    if (client_leaderboard(&c, &view, input_str("You won, enter your nickname: "))) {
+      status->msg = "Press 'q' to quit...";
+    } else {
+      status->msg = "lost the server! press 'q' to quit";
+    }
+  } else if (c.reply.outcome == outcome_lost) {
+    status->msg = "Game over! press 'q' to exit";
+  } else {
+    status->msg = "left the game. press 'q' to quit";
+  }
+  status->moves = view.moves;
+  close(c.fd);
+  arena_free(arena);
+}
@@ -0,0 +1,542 @@
+/*
+Headless commands. When uni-void is started with arguments, the first
+argument selects one of the commands below and the game itself never
+touches the terminal. These are meant for tooling: benchmarks, grading
+and the like.
+
+  uni-void solve-bench [order] [threads] [scramble] [seed] [tt megabytes]
+  uni-void reduce-bench [max order] [boards] [refine] [seed]
+  uni-void wd-bench [boards] [seed] [node limit]
+  uni-void state-space [order] [threads] [samples] [seed]
+  uni-void gen-bench [boards] [verify] [seed]
+  uni-void eval-bench [boards] [rounds] [seed]
+  uni-void verify [replay files]
+  uni-void stats [leaderboard file] [json|csv]
+  uni-void merge <output> <leaderboard files...>
+  uni-void serve [socket]
+*/
+
+#pragma once
+
+#include "libunivoid.h"
+#include "solver.c"
+#include "reduction_solver.c"
+#include "state_space.c"
+#include "generator.c"
+#include "batch_eval.c"
+#include "replay.c"
+#include "leaderboard.c"
+#include "analytics.c"
+#include "merge.c"
+#include "server.c"
+
+struct command {
+  const char* name;
+  const char* usage;
+  int (*run)(int argc, char* argv[]);
+};
+
+// returns argv[i] as an integer, or fallback if it was not given.
+static long arg_or(int argc, char* argv[], int i, long fallback) {
+  return (i < argc) ? atol(argv[i]) : fallback;
+}
+
+// solves one board with 1, 2, 4, ... threads and reports nodes/sec and
+// speedup over the single threaded solver. a transposition table of the
+// given size (in megabytes) is used when one is asked for.
+static int cmd_solve_bench(int argc, char* argv[]) {
+  int order = arg_or(argc, argv, 1, 4);
+  int max_threads = arg_or(argc, argv, 2, sysconf(_SC_NPROCESSORS_ONLN));
+  int scramble = arg_or(argc, argv, 3, (order <= 3) ? 0 : order * 15);
+  unsigned seed = arg_or(argc, argv, 4, 1);
+  size_t tt_megabytes = arg_or(argc, argv, 5, 0);
+  if (order < 2 || order > SOLVER_MAX_ORDER || max_threads < 1) {
+    fprintf(stderr, "solve-bench: invalid order or thread count\n");
+    return 1;
+  }
+
+  struct puzzle p;
+  srand(seed);
+  puzzle_scramble(&p, order, scramble);
+
+  struct transposition_table tt;
+  struct solver_config cfg = { .heuristic = heur_linear_conflict };
+  struct solver_stats stats;
+  Key solution[SOLVER_MAX_DEPTH];
+  double base = 0;
+
+  if (tt_megabytes > 0) {
+    if (!tt_init(&tt, tt_megabytes)) {
+      fprintf(stderr, "solve-bench: couldn't allocate %zu MB transposition table\n", tt_megabytes);
+      return 1;
+    }
+    cfg.tt = &tt;
+  }
+
+  printf("order %d, scramble %d, seed %u\n", order, scramble, seed);
+  printf("%-8s %-7s %-12s %-10s %-12s %s\n", "threads", "length", "nodes", "seconds", "nodes/sec", "speedup");
+  for (int threads = 1; ; threads = (threads * 2 < max_threads) ? threads * 2 : max_threads) {
+    cfg.threads = threads;
+    int length = parallel_ida_star(&p, solution, &cfg, &stats);
+    if (threads == 1) base = stats.seconds;
+    printf("%-8d %-7d %-12lu %-10.3f %-12.0f %.2fx\n",
+           threads,
+           length,
+           stats.nodes,
+           stats.seconds,
+           stats.nodes / (stats.seconds > 0 ? stats.seconds : 1e-9),
+           base / (stats.seconds > 0 ? stats.seconds : 1e-9));
+    if (cfg.tt) {
+      printf("         tt: %zu MB, %lu probes, %.1f%% hits, %lu stores, %.1f%% occupied\n",
+             tt_bytes(&tt) >> 20,
+             stats.tt.probes,
+             stats.tt.probes ? stats.tt.hits * 100.0 / stats.tt.probes : 0,
+             stats.tt.stores,
+             tt_occupancy(&tt) * 100);
+    }
+    if (threads == max_threads) break;
+  }
+  if (cfg.tt) tt_free(&tt);
+  return 0;
+}
+
+// solves random boards of every order with the reduction solver and reports
+// solution lengths and time per board. every solution is replayed and checked.
+static int cmd_reduce_bench(int argc, char* argv[]) {
+  int max_order = arg_or(argc, argv, 1, SOLVER_MAX_ORDER);
+  int boards = arg_or(argc, argv, 2, 20);
+  bool refine = arg_or(argc, argv, 3, 1);
+  unsigned seed = arg_or(argc, argv, 4, 1);
+  if (max_order < 2 || max_order > SOLVER_MAX_ORDER || boards < 1) {
+    fprintf(stderr, "reduce-bench: invalid order or board count\n");
+    return 1;
+  }
+
+  srand(seed);
+  printf("%-6s %-10s %-10s %-10s %s\n", "order", "avg moves", "avg ms", "worst ms", "failures");
+  for (int order = 2; order <= max_order; order++) {
+    double total = 0, worst = 0;
+    uint64_t moves = 0;
+    int failures = 0;
+    for (int i = 0; i < boards; i++) {
+      struct puzzle p, check;
+      struct move_list solution = { 0 };
+      puzzle_scramble(&p, order, 0);
+      check = p;
+
+      double start = monotonic_seconds();
+      int length = reduction_solve(&p, &solution, refine, NULL);
+      double elapsed = monotonic_seconds() - start;
+      total += elapsed;
+      if (elapsed > worst) worst = elapsed;
+
+      for (uint32_t j = 0; j < solution.length; j++) puzzle_move(&check, solution.keys[j]);
+      if (length == SOLVER_FAILED || !puzzle_is_goal(&check)) failures++;
+      else moves += length;
+      move_list_free(&solution);
+    }
+    printf("%-6d %-10.1f %-10.3f %-10.3f %d\n", order, (double)moves / boards, total * 1000 / boards, worst * 1000, failures);
+  }
+  return 0;
+}
+
+// solves the same seeded 4x4 games (as dealt by populate_mat) with every
+// heuristic and compares nodes expanded and wall time. searches that hit
+// the node limit are reported as such and count the limit as their nodes.
+static int cmd_wd_bench(int argc, char* argv[]) {
+  int boards = arg_or(argc, argv, 1, 10);
+  unsigned seed = arg_or(argc, argv, 2, 1);
+  uint64_t node_limit = arg_or(argc, argv, 3, 100000000);
+  if (boards < 1) {
+    fprintf(stderr, "wd-bench: invalid board count\n");
+    return 1;
+  }
+  const Heuristic heuristics[] = { heur_manhattan, heur_linear_conflict, heur_walking_distance };
+  const char* names[] = { "manhattan", "md+lc", "wd+lc" };
+  const int n_heuristics = sizeof(heuristics) / sizeof(Heuristic);
+  uint64_t total_nodes[n_heuristics];
+  double total_seconds[n_heuristics];
+  memset(total_nodes, 0, sizeof(total_nodes));
+  memset(total_seconds, 0, sizeof(total_seconds));
+
+  double start = monotonic_seconds();
+  if (wd_table_get() == NULL) {
+    fprintf(stderr, "wd-bench: couldn't load walking distance tables\n");
+    return 1;
+  }
+  printf("walking distance tables ready in %.3f s\n", monotonic_seconds() - start);
+
+  Arena* arena = err_expect(arena_err, arena_init(128));
+  struct game_state gs = game_state_init(arena, 4);
+  Key solution[SOLVER_MAX_DEPTH];
+  printf("%-6s %-10s %-7s %-12s %-10s\n", "seed", "heuristic", "length", "nodes", "seconds");
+  for (int i = 0; i < boards; i++) {
+    struct puzzle p;
+    srand(seed + i);
+    populate_mat(&gs);
+    puzzle_from_game_state(&p, &gs);
+    for (int h = 0; h < n_heuristics; h++) {
+      struct solver_config cfg = { .heuristic = heuristics[h], .node_limit = node_limit };
+      struct solver_stats stats;
+      int length = ida_star(&p, solution, &cfg, &stats);
+      total_nodes[h] += stats.nodes;
+      total_seconds[h] += stats.seconds;
+      if (length == SOLVER_FAILED) {
+        printf("%-6u %-10s %-7s %-12lu %-10.3f\n", seed + i, names[h], "limit", stats.nodes, stats.seconds);
+      } else {
+        printf("%-6u %-10s %-7d %-12lu %-10.3f\n", seed + i, names[h], length, stats.nodes, stats.seconds);
+      }
+    }
+  }
+  printf("\n%-10s %-14s %-10s %s\n", "heuristic", "total nodes", "seconds", "nodes vs manhattan");
+  for (int h = 0; h < n_heuristics; h++) {
+    printf("%-10s %-14lu %-10.3f %.4f\n", names[h], total_nodes[h], total_seconds[h],
+           (double)total_nodes[h] / (total_nodes[0] ? total_nodes[0] : 1));
+  }
+  arena_free(arena);
+  return 0;
+}
+
+// boards solved by the threads of cmd_state_space() on orders too big for
+// an exhaustive search.
+struct sample_pool {
+  struct puzzle* boards;
+  int* lengths;
+  int count;
+  atomic_int next;
+};
+
+static void* sample_worker(void* arg) {
+  struct sample_pool* pool = arg;
+  Key path[SOLVER_MAX_DEPTH];
+  struct solver_config cfg = { .heuristic = heur_walking_distance };
+  for (int i; (i = atomic_fetch_add(&pool->next, 1)) < pool->count; ) {
+    pool->lengths[i] = ida_star(&pool->boards[i], path, &cfg, NULL);
+  }
+  return NULL;
+}
+
+static void print_distribution(const uint64_t* counts, int max_distance, uint64_t total) {
+  double mean = 0;
+  printf("%-9s %-12s %s\n", "distance", "boards", "share");
+  for (int d = 0; d <= max_distance; d++) {
+    if (counts[d] == 0) continue;
+    mean += (double)d * counts[d] / total;
+    printf("%-9d %-12lu %.4f%%\n", d, counts[d], counts[d] * 100.0 / total);
+  }
+  printf("boards: %lu, mean distance: %.2f, max distance: %d\n", total, mean, max_distance);
+}
+
+// prints the distribution of optimal solution lengths. boards up to 3x3 are
+// searched exhaustively (the 3x3 table is saved for the game), larger ones
+// are sampled and solved on all threads.
+static int cmd_state_space(int argc, char* argv[]) {
+  int order = arg_or(argc, argv, 1, 3);
+  int threads = arg_or(argc, argv, 2, sysconf(_SC_NPROCESSORS_ONLN));
+  int samples = arg_or(argc, argv, 3, 16);
+  unsigned seed = arg_or(argc, argv, 4, 1);
+  if (order < 2 || order > SOLVER_MAX_ORDER || threads < 1 || samples < 1) {
+    fprintf(stderr, "state-space: invalid order, thread or sample count\n");
+    return 1;
+  }
+
+  double start = monotonic_seconds();
+  if (order * order <= SS_MAX_CELLS) {
+    struct state_space ss;
+    uint64_t total = 0;
+    if (!ss_generate(&ss, order, threads)) {
+      fprintf(stderr, "state-space: out of memory\n");
+      return 1;
+    }
+    for (int d = 0; d <= ss.max_distance; d++) total += ss.level_count[d];
+    printf("order %d: searched %lu states on %d threads in %.3f s\n", order, ss.states, threads, monotonic_seconds() - start);
+    print_distribution(ss.level_count, ss.max_distance, total);
+    if (order == 3) {
+      if (ss_save(&ss, DISTANCE_TABLE_FILE)) printf("table saved to %s\n", DISTANCE_TABLE_FILE);
+      else fprintf(stderr, "state-space: couldn't write %s\n", DISTANCE_TABLE_FILE);
+    }
+    ss_free(&ss);
+    return 0;
+  }
+
+  struct sample_pool pool = {
+    .boards = malloc(sizeof(struct puzzle) * samples),
+    .lengths = malloc(sizeof(int) * samples),
+    .count = samples,
+  };
+  pthread_t workers[threads];
+  uint64_t counts[SOLVER_MAX_DEPTH] = { 0 };
+  int max_distance = 0, solved = 0;
+  srand(seed);
+  for (int i = 0; i < samples; i++) puzzle_scramble(&pool.boards[i], order, 0);
+  atomic_init(&pool.next, 0);
+  for (int t = 0; t < threads; t++) pthread_create(&workers[t], NULL, sample_worker, &pool);
+  for (int t = 0; t < threads; t++) pthread_join(workers[t], NULL);
+  for (int i = 0; i < samples; i++) {
+    if (pool.lengths[i] == SOLVER_FAILED) continue;
+    counts[pool.lengths[i]]++;
+    solved++;
+    if (pool.lengths[i] > max_distance) max_distance = pool.lengths[i];
+  }
+  printf("order %d: solved %d of %d random boards on %d threads in %.3f s\n", order, solved, samples, threads, monotonic_seconds() - start);
+  if (solved > 0) print_distribution(counts, max_distance, solved);
+  free(pool.boards);
+  free(pool.lengths);
+  return 0;
+}
+
+// deals boards for every mode and reports boards/sec and how many needed a
+// search. the first few boards of every optimal band are solved to check
+// them, and the move budget of the dealt boards is timed.
+static int cmd_gen_bench(int argc, char* argv[]) {
+  int boards = arg_or(argc, argv, 1, 1000);
+  int verify = arg_or(argc, argv, 2, 5);
+  unsigned seed = arg_or(argc, argv, 3, 1);
+  if (boards < 1) {
+    fprintf(stderr, "gen-bench: invalid board count\n");
+    return 1;
+  }
+  const char* names[] = { [mode_easy] = "easy", [mode_normal] = "normal", [mode_hard] = "hard" };
+
+  // table loading is not what is measured here.
+  distance_table_get();
+  wd_table_get();
+  srand(seed);
+  printf("%-7s %-6s %-10s %-10s %-10s %-8s %-9s %-9s %-11s %s\n",
+         "mode", "order", "band", "boards/s", "direct", "searched", "failures", "verified", "avg budget", "budget ms");
+  for (Mode mode = mode_easy; mode <= mode_hard; mode++) {
+    int order = mode + MODE_OFFSET, failures = 0, checked = 0, in_band = 0, budgets = (boards < 100) ? boards : 100;
+    double budget_total = 0, budget_seconds = 0, budget_worst = 0;
+    struct difficulty_band band = mode_bands[mode];
+    struct generator_stats stats = { 0 };
+    struct puzzle p;
+    Key path[SOLVER_MAX_DEPTH];
+
+    double start = monotonic_seconds();
+    for (int i = 0; i < boards; i++) {
+      if (!generate_in_band(&p, order, band, &stats)) failures++;
+    }
+    double elapsed = monotonic_seconds() - start;
+
+    for (int i = 0; band.optimal && i < verify; i++) {
+      struct solver_config cfg = { .heuristic = generator_heuristic(order) };
+      if (!generate_in_band(&p, order, band, NULL)) continue;
+      int length = ida_star(&p, path, &cfg, NULL);
+      checked++;
+      if (length >= band.min && length <= band.max) in_band++;
+    }
+    for (int i = 0; i < budgets; i++) {
+      generate_in_band(&p, order, band, NULL);
+      double budget_start = monotonic_seconds();
+      budget_total += puzzle_move_budget(&p);
+      double budget_elapsed = monotonic_seconds() - budget_start;
+      budget_seconds += budget_elapsed;
+      if (budget_elapsed > budget_worst) budget_worst = budget_elapsed;
+    }
+    char band_str[32], verified_str[32];
+    snprintf(band_str, sizeof(band_str), "%d-%d%s", band.min, band.max, band.optimal ? "" : " h");
+    snprintf(verified_str, sizeof(verified_str), "%d/%d", in_band, checked);
+    printf("%-7s %-6d %-10s %-10.0f %-10lu %-8lu %-9d %-9s %-11.1f %.2f avg, %.2f worst\n",
+           names[mode], order, band_str, boards / (elapsed > 0 ? elapsed : 1e-9),
+           stats.accepted, stats.solved, failures, verified_str,
+           budget_total / budgets, budget_seconds * 1000 / budgets, budget_worst * 1000);
+  }
+  return 0;
+}
+
+// deals random boards of orders 3 to 6 into a batch and reports boards/sec
+// of the scalar evaluator and of the one board_batch_eval() picks. both are
+// checked board by board against the heuristic of the solvers.
+static int cmd_eval_bench(int argc, char* argv[]) {
+  int boards = arg_or(argc, argv, 1, 100000);
+  int rounds = arg_or(argc, argv, 2, 20);
+  unsigned seed = arg_or(argc, argv, 3, 1);
+  if (boards < 1 || rounds < 1) {
+    fprintf(stderr, "eval-bench: invalid board or round count\n");
+    return 1;
+  }
+  const char* isa = board_batch_isa();
+  int mismatches = 0;
+  srand(seed);
+  printf("%-6s %-8s %-14s %-14s %-8s %s\n", "order", "boards", "scalar/s", isa, "speedup", "mismatches");
+  for (int order = 3; order <= 6; order++) {
+    struct board_batch batch;
+    uint16_t* expected = malloc(sizeof(uint16_t) * boards * 2);
+    if (expected == NULL || !board_batch_init(&batch, order, boards)) {
+      fprintf(stderr, "eval-bench: out of memory\n");
+      free(expected);
+      return 1;
+    }
+    struct solver_config cfg = { .heuristic = heur_linear_conflict };
+    struct search s;
+    for (int i = 0; i < boards; i++) {
+      struct puzzle p;
+      puzzle_scramble(&p, order, 0);
+      board_batch_add(&batch, p.tiles);
+      search_init(&s, &p, NULL, &cfg);
+      expected[i * 2] = s.md;
+      expected[i * 2 + 1] = s.lc;
+    }
+
+    double seconds[2];
+    int wrong = 0;
+    for (int e = 0; e < 2; e++) {
+      double start = monotonic_seconds();
+      for (int r = 0; r < rounds; r++) {
+        if (e == 0) board_batch_eval_scalar(&batch);
+        else board_batch_eval(&batch);
+      }
+      seconds[e] = monotonic_seconds() - start;
+      for (int i = 0; i < boards; i++) {
+        wrong += batch.md[i] != expected[i * 2] || batch.lc[i] != expected[i * 2 + 1];
+      }
+      memset(batch.md, 0, sizeof(uint16_t) * batch.capacity);
+      memset(batch.lc, 0, sizeof(uint16_t) * batch.capacity);
+    }
+    double evaluated = (double)boards * rounds;
+    printf("%-6d %-8d %-14.0f %-14.0f %-8.2f %d\n", order, boards, evaluated / (seconds[0] > 0 ? seconds[0] : 1e-9),
+           evaluated / (seconds[1] > 0 ? seconds[1] : 1e-9), seconds[0] / (seconds[1] > 0 ? seconds[1] : 1e-9), wrong);
+    mismatches += wrong;
+    board_batch_free(&batch);
+    free(expected);
+  }
+  return mismatches > 0;
+}
+
+// game states the verifier replays on, one per order.
+struct verifier {
+  Arena* arena;
+  struct game_state states[CUSTOM_MAX_ORDER + 1];
+  uint64_t replays;
+  double seconds;
+};
+
+// replays r. returns what is wrong with it, NULL if it checks out.
+static const char* verify_replay(struct verifier* v, const struct replay* r, struct replay_result* result) {
+  if (r->order < 2 || r->order > CUSTOM_MAX_ORDER) return "bad order";
+  if (v->states[r->order].order == 0) v->states[r->order] = game_state_init(v->arena, r->order);
+  double start = monotonic_seconds();
+  replay_verify(r, &v->states[r->order], result);
+  v->seconds += monotonic_seconds() - start;
+  v->replays++;
+  if (!result->legal) return "illegal move";
+  if (!result->solved) return "board not sorted";
+  return NULL;
+}
+
+// checks every leaderboard row against its replay, or the given replay
+// files. exits with 1 if anything didn't check out, rows without a replay
+// included: a claim that can't be checked isn't verified.
+static int cmd_verify(int argc, char* argv[]) {
+  struct verifier v = { 0 };
+  v.arena = err_expect(arena_err, arena_init(sizeof(int) * CUSTOM_MAX_ORDER * CUSTOM_MAX_ORDER));
+  struct replay_result result;
+  int bad = 0, missing = 0, total = 0;
+
+  if (argc > 1) {
+    for (int i = 1; i < argc; i++, total++) {
+      struct replay r = { 0 };
+      const char* problem = replay_load(&r, argv[i]) ? verify_replay(&v, &r, &result) : "unreadable";
+      if (problem) {
+        printf("%s: %s\n", argv[i], problem);
+        bad++;
+      } else {
+        printf("%s: ok, %dx%d in %u moves, %u counted\n", argv[i], r.order, r.order, r.length, result.moves);
+      }
+      replay_free(&r);
+    }
+  } else {
+    csv_arena = err_expect(arena_err, arena_init(1024));
+    struct leaderboard_record records[LEADERBOARD_MAX_RECORDS];
+    total = load_leaderboard(records, 0);
+    printf("%-6s %-6s %-16s %-11s %s\n", "order", "moves", "player", "time", "status");
+    for (int i = 0; i < total; i++) {
+      char path[128], status[64] = "ok";
+      struct replay r = { 0 };
+      replay_path(path, sizeof(path), records[i].time);
+      const char* problem = NULL;
+      if (!replay_load(&r, path)) {
+        snprintf(status, sizeof(status), "no replay");
+        missing++;
+      } else if ((problem = verify_replay(&v, &r, &result))) {
+        snprintf(status, sizeof(status), "MISMATCH: %s", problem);
+        bad++;
+      } else if (r.order != records[i].order || result.moves != records[i].moves) {
+        snprintf(status, sizeof(status), "MISMATCH: replay is %dx%d with %u moves", r.order, r.order, result.moves);
+        bad++;
+      }
+      printf("%-6d %-6d %-16s %-11ld %s\n", records[i].order, records[i].moves, records[i].player_name, (long)records[i].time, status);
+      replay_free(&r);
+    }
+    arena_free(csv_arena);
+  }
+
+  printf("checked %d, %d mismatched, %d without replay. %lu replays in %.3f s (%.0f/s)\n",
+         total, bad, missing, v.replays, v.seconds, v.replays / (v.seconds > 0 ? v.seconds : 1e-9));
+  arena_free(v.arena);
+  return (bad || missing) ? 1 : 0;
+}
+
+// statistics of a leaderboard file of any size, see analytics.c
+static int cmd_stats(int argc, char* argv[]) {
+  const char* path = (argc > 1) ? argv[1] : LEADERBOARD_FILE;
+  const char* format = (argc > 2) ? argv[2] : "json";
+  if (strcmp(format, "json") != 0 && strcmp(format, "csv") != 0) {
+    fprintf(stderr, "stats: format must be json or csv\n");
+    return 1;
+  }
+  if (!leaderboard_stats(path, strcmp(format, "json") == 0)) {
+    fprintf(stderr, "stats: couldn't read %s\n", path);
+    return 1;
+  }
+  return 0;
+}
+
+// merges the leaderboards of many hosts into one file, keeping as many
+// rows of every order as the game shows. see merge.c
+static int cmd_merge(int argc, char* argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "merge: needs an output file and the leaderboard files to merge\n");
+    return 1;
+  }
+  struct merge_stats stats;
+  double start = monotonic_seconds();
+  if (!merge_leaderboards(argv[1], argv + 2, argc - 2, LEADERBOARD_ENTRIES, &stats)) return 1;
+  printf("merged %d files (%u runs) into %s in %.3f s: %lu records, %lu duplicates, %lu past the %d kept per order, %lu written, %lu lines skipped\n",
+         argc - 2, stats.runs, argv[1], monotonic_seconds() - start, stats.records, stats.duplicates,
+         stats.dropped, LEADERBOARD_ENTRIES, stats.written, stats.skipped);
+  return 0;
+}
+
+// hosts games for `uni-void --connect` clients, see server.c
+static int cmd_serve(int argc, char* argv[]) {
+  return server_run((argc > 1) ? argv[1] : SERVER_SOCKET);
+}
+
+static const struct command commands[] = {
+  { "solve-bench", "[order] [threads] [scramble] [seed] [tt megabytes]", cmd_solve_bench },
+  { "reduce-bench", "[max order] [boards] [refine] [seed]", cmd_reduce_bench },
+  { "wd-bench", "[boards] [seed] [node limit]", cmd_wd_bench },
+  { "state-space", "[order] [threads] [samples] [seed]", cmd_state_space },
+  { "gen-bench", "[boards] [verify] [seed]", cmd_gen_bench },
+  { "eval-bench", "[boards] [rounds] [seed]", cmd_eval_bench },
+  { "verify", "[replay files]", cmd_verify },
+  { "stats", "[leaderboard file] [json|csv]", cmd_stats },
+  { "merge", "<output> <leaderboard files...>", cmd_merge },
+  { "serve", "[socket]", cmd_serve },
+};
+
+// runs the command named by argv[0]. returns the exit status.
+int run_command(int argc, char* argv[]) {
+  size_t n_commands = sizeof(commands) / sizeof(struct command);
+  for (size_t i = 0; i < n_commands; i++) {
+    if (strcmp(argv[0], commands[i].name) == 0) {
+      return commands[i].run(argc, argv);
+    }
+  }
+  fprintf(stderr, "unknown command '%s'. available commands:\n", argv[0]);
+  for (size_t i = 0; i < n_commands; i++) {
+    fprintf(stderr, "  uni-void %s %s\n", commands[i].name, commands[i].usage);
+  }
+  return 1;
+}
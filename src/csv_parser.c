@@ -101,7 +101,7 @@ int parse_next_record(String* lexer, Token* record, uint32_t record_len) {
       tok = parse_next_token(lexer);
       continue;
     }
-    record[tok_count] = tok;
+    if (tok_count < record_len) record[tok_count] = tok; // extra fields make it a bad record below
     tok_count++;
     tok = parse_next_token(lexer);
   }
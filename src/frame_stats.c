@@ -0,0 +1,186 @@
+/*
+Timings of the game loop, for finding out where the time between a key
+press and the screen goes.
+
+Every stage of handling input and drawing a frame is timed with the
+monotonic clock and counted into a histogram of its own. Histograms are
+log-linear: 8 buckets for every power of two nanoseconds, so any value
+is off by at most 12.5% and the whole range from nanoseconds to seconds
+fits in a few hundred counters. p50 and p99 are read straight from
+them.
+
+  - 't' shows or hides p50/p99 of every stage above the status line.
+  - `uni-void --stats` starts with the overlay shown and, on exit, writes
+    the histograms to FRAME_STATS_FILE and the stages of every frame to
+    FRAME_LOG_FILE, both csv.
+
+Nothing is measured until either of them asks for it.
+*/
+
+#pragma once
+
+#include <ncurses.h>
+#include "libunivoid.h"
+
+// histograms of every stage, one row per non-empty bucket.
+#define FRAME_STATS_FILE "game_files/frame_stats.csv"
+
+// stages of every frame, one row per frame.
+#define FRAME_LOG_FILE "game_files/frame_log.csv"
+
+// frames kept for FRAME_LOG_FILE. later ones still go into the histograms.
+#define FRAME_LOG_MAX 100000
+
+#define STATS_SUB_BUCKETS 8 // buckets per power of two
+#define STATS_BUCKETS (40 * STATS_SUB_BUCKETS) // up to about 18 minutes
+
+typedef enum {
+  stage_decode, // decode_key()
+  stage_move, // mov_zero()
+  stage_matrix, // update_matrix_view()
+  stage_status, // update_status_line()
+  stage_refresh, // refresh()
+  stage_frame, // first key of a batch read, until the frame is on screen
+  STAGE_COUNT,
+} Stage;
+
+static const char* stage_names[] = {
+  [stage_decode] = "decode",
+  [stage_move] = "move",
+  [stage_matrix] = "matrix",
+  [stage_status] = "status",
+  [stage_refresh] = "refresh",
+  [stage_frame] = "frame",
+};
+
+// stages of one frame, decode and move summed over the keys of its batch.
+struct frame_record {
+  uint32_t keys;
+  uint64_t ns[STAGE_COUNT];
+};
+
+struct frame_stats {
+  bool visible; // overlay is drawn
+  bool dump; // files are written on exit
+  uint64_t count[STAGE_COUNT];
+  uint64_t hist[STAGE_COUNT][STATS_BUCKETS];
+  struct frame_record current;
+  struct frame_record* frames;
+  uint32_t n_frames;
+  uint32_t capacity;
+  bool log_full; // out of memory, later frames only go into the histograms
+};
+
+// true while anything is interested in timings.
+static inline bool stats_on(const struct frame_stats* fs) {
+  return fs->visible || fs->dump;
+}
+
+static inline uint64_t stats_clock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// times call as stage of the current frame. the clock isn't even read
+// while stats are off.
+#define stats_timed(fs, stage, call) do { \
+                                       uint64_t _start = stats_on(fs) ? stats_clock() : 0; \
+                                       call; \
+                                       if (stats_on(fs)) stats_add(fs, stage, stats_clock() - _start); \
+                                     } while (0)
+
+static int stats_bucket(uint64_t ns) {
+  if (ns < STATS_SUB_BUCKETS) return ns;
+  int exp = 63 - __builtin_clzll(ns); // at least 3
+  int bucket = (exp - 2) * STATS_SUB_BUCKETS + ((ns >> (exp - 3)) & (STATS_SUB_BUCKETS - 1));
+  return (bucket < STATS_BUCKETS) ? bucket : STATS_BUCKETS - 1;
+}
+
+// smallest value that falls into bucket.
+static uint64_t stats_bucket_low(int bucket) {
+  if (bucket < STATS_SUB_BUCKETS) return bucket;
+  int exp = bucket / STATS_SUB_BUCKETS + 2;
+  return (uint64_t)(STATS_SUB_BUCKETS + bucket % STATS_SUB_BUCKETS) << (exp - 3);
+}
+
+void stats_add(struct frame_stats* fs, Stage stage, uint64_t ns) {
+  fs->count[stage]++;
+  fs->hist[stage][stats_bucket(ns)]++;
+  fs->current.ns[stage] += ns;
+}
+
+// closes the frame that was just drawn for a batch of keys.
+void stats_frame_end(struct frame_stats* fs, uint32_t keys) {
+  fs->current.keys = keys;
+  if (fs->dump && !fs->log_full && fs->n_frames < FRAME_LOG_MAX) {
+    if (fs->n_frames == fs->capacity) {
+      uint32_t capacity = (fs->capacity == 0) ? 1024 : fs->capacity * 2;
+      struct frame_record* frames = realloc(fs->frames, sizeof(struct frame_record) * capacity);
+      if (frames == NULL) {
+        fs->log_full = true; // the frames logged so far are still written
+      } else {
+        fs->frames = frames;
+        fs->capacity = capacity;
+      }
+    }
+    if (!fs->log_full) fs->frames[fs->n_frames++] = fs->current;
+  }
+  fs->current = (struct frame_record) { 0 };
+}
+
+// value below which given percent of the samples of stage are, in ns.
+uint64_t stats_percentile(const struct frame_stats* fs, Stage stage, double percent) {
+  uint64_t rank = fs->count[stage] * percent / 100, seen = 0;
+  for (int b = 0; b < STATS_BUCKETS; b++) {
+    seen += fs->hist[stage][b];
+    if (seen > rank) return stats_bucket_low(b + 1);
+  }
+  return 0;
+}
+
+// draws p50/p99 of every stage in microseconds on the line above the status line.
+void stats_draw(const struct frame_stats* fs) {
+  char line[256];
+  int len = snprintf(line, sizeof(line), " p50/p99 us");
+  for (int s = 0; s < STAGE_COUNT && len < (int)sizeof(line); s++) {
+    len += snprintf(line + len, sizeof(line) - len, "  %s %.1f/%.1f", stage_names[s],
+                    stats_percentile(fs, s, 50) / 1e3, stats_percentile(fs, s, 99) / 1e3);
+  }
+  attron(A_DIM);
+  mvaddnstr(LINES - 2, 0, line, COLS);
+  attroff(A_DIM);
+}
+
+// writes the histograms and the frame log. returns false if a file couldn't be written.
+bool stats_save(const struct frame_stats* fs) {
+  FILE* fp = fopen(FRAME_STATS_FILE, "w");
+  if (fp == NULL) return false;
+  fprintf(fp, "\"Stage\",\"Low ns\",\"High ns\",\"Count\"\n");
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    for (int b = 0; b < STATS_BUCKETS; b++) {
+      if (fs->hist[s][b] == 0) continue;
+      fprintf(fp, "%s,%lu,%lu,%lu\n", stage_names[s], stats_bucket_low(b), stats_bucket_low(b + 1) - 1, fs->hist[s][b]);
+    }
+  }
+  fclose(fp);
+
+  fp = fopen(FRAME_LOG_FILE, "w");
+  if (fp == NULL) return false;
+  fprintf(fp, "\"Frame\",\"Keys\"");
+  for (int s = 0; s < STAGE_COUNT; s++) fprintf(fp, ",\"%s ns\"", stage_names[s]);
+  fprintf(fp, "\n");
+  for (uint32_t i = 0; i < fs->n_frames; i++) {
+    fprintf(fp, "%u,%u", i, fs->frames[i].keys);
+    for (int s = 0; s < STAGE_COUNT; s++) fprintf(fp, ",%lu", fs->frames[i].ns[s]);
+    fprintf(fp, "\n");
+  }
+  fclose(fp);
+  return true;
+}
+
+void stats_free(struct frame_stats* fs) {
+  free(fs->frames);
+  fs->frames = NULL;
+  fs->n_frames = fs->capacity = 0;
+}
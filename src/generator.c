@@ -0,0 +1,191 @@
+/*
+Deals boards within a difficulty band.
+
+A band is a range of optimal solution lengths (or, on boards too big to
+solve optimally, a range of heuristic values). Boards are produced by a
+random walk from the solved board that prefers moves raising the
+heuristic, which gives two bounds for free:
+
+  - lower bound : the heuristic of the final board
+  - upper bound : the length of the walk
+
+The walk stops as soon as the heuristic reaches a random target inside
+the band, so most boards land with both bounds in the band and are
+accepted as they are. Only boards whose heuristic stayed below the band
+are handed to a depth-limited IDA*, which just has to tell whether a
+solution shorter than the band exists.
+
+3x3 boards don't need any of this, they are drawn straight from the
+distance table of state_space.c.
+*/
+
+#pragma once
+
+#include "../lib/uni-void.c"
+#include "solver.c"
+#include "reduction_solver.c"
+#include "state_space.c"
+
+// nodes the depth-limited search may spend on a single candidate.
+#define GENERATOR_NODE_LIMIT 200000
+
+// candidates tried before giving up on a band.
+#define GENERATOR_MAX_TRIES 1000
+
+// nodes the optimal search may spend on a move budget. a few milliseconds.
+#define MOVE_BUDGET_NODE_LIMIT 20000
+
+struct difficulty_band {
+  int min, max;
+  bool optimal; // the band is on optimal solution length, not the heuristic
+};
+
+struct generator_stats {
+  uint64_t candidates; // boards walked
+  uint64_t accepted; // boards accepted on bounds alone
+  uint64_t solved; // boards that needed a search
+  uint64_t accepted_solved; // of which accepted
+};
+
+// band of every mode that deals a generated board. custom boards are random.
+static const struct difficulty_band mode_bands[] = {
+  [mode_easy] = { 18, 24, true },
+  [mode_normal] = { 34, 44, true },
+  [mode_hard] = { 70, 90, false },
+};
+
+static Heuristic generator_heuristic(int order) {
+  return (order == WD_ORDER) ? heur_walking_distance : heur_linear_conflict;
+}
+
+// draws a 3x3 board uniformly from the boards of the band.
+static bool generate_from_table(struct puzzle* p, struct difficulty_band band) {
+  return puzzle_from_table(p, band.min, band.max);
+}
+
+// walks s away from the solved board until its heuristic reaches target or
+// the walk is max_steps long.
+static void generator_walk(struct search* s, int target, int max_steps) {
+  Key prev = key_invalid;
+  int steps = 0;
+  while (search_h(s) < target && steps < max_steps) {
+    int froms[4], rising[4], n_legal = 0, n_rising = 0, h = search_h(s);
+    for (int m = 0; m < 4; m++) {
+      int from = puzzle_move_target(s->p.order, s->p.zero, solver_moves[m]);
+      if (from < 0 || solver_moves[m] == -prev) continue;
+      struct search_undo u;
+      int zero = s->p.zero;
+      search_apply(s, from, &u);
+      if (search_h(s) > h) rising[n_rising++] = m;
+      search_undo(s, zero, &u);
+      froms[n_legal++] = m;
+    }
+    int m = (n_rising > 0) ? rising[rand() % n_rising] : froms[rand() % n_legal];
+    struct search_undo u;
+    search_apply(s, puzzle_move_target(s->p.order, s->p.zero, solver_moves[m]), &u);
+    prev = solver_moves[m];
+    steps++;
+  }
+}
+
+// fills p with a board of given order inside band. returns false if none
+// was found within GENERATOR_MAX_TRIES candidates. stats may be NULL.
+bool generate_in_band(struct puzzle* p, int order, struct difficulty_band band, struct generator_stats* stats) {
+  struct generator_stats local = { 0 };
+  if (stats == NULL) stats = &local;
+  if (order < 2 || order > SOLVER_MAX_ORDER || band.min > band.max) return false;
+  if (order == 3 && band.optimal) {
+    stats->candidates++;
+    stats->accepted++;
+    return generate_from_table(p, band);
+  }
+
+  struct search* s = malloc(sizeof(struct search));
+  if (s == NULL) return false;
+  struct solver_config cfg = { .heuristic = generator_heuristic(order), .node_limit = GENERATOR_NODE_LIMIT };
+  struct puzzle goal;
+  Key path[SOLVER_MAX_DEPTH];
+  bool found = false;
+  puzzle_goal(&goal, order);
+
+  for (int i = 0; i < GENERATOR_MAX_TRIES && !found; i++) {
+    search_init(s, &goal, NULL, &cfg);
+    int target = band.min + rand() % (band.max - band.min + 1);
+    // heuristic bands have no upper bound to keep, the walk may run longer.
+    generator_walk(s, target, band.optimal ? band.max : band.max * 4);
+    int h = search_h(s);
+    stats->candidates++;
+
+    if (h >= band.min && h <= band.max) {
+      // optimal length is between h and steps, both inside the band.
+      found = true;
+      stats->accepted++;
+    } else if (band.optimal && h < band.min) {
+      // the board is in the band unless a solution shorter than band.min exists.
+      struct solver_stats solve_stats;
+      stats->solved++;
+      int length = ida_search(&s->p, NULL, band.min - 1, path, &cfg, &solve_stats);
+      if (length == SOLVER_FAILED && solve_stats.nodes < GENERATOR_NODE_LIMIT) {
+        found = true;
+        stats->accepted_solved++;
+      }
+    }
+  }
+  if (found) *p = s->p;
+  free(s);
+  return found;
+}
+
+// moves a player gets for p: the length of an optimal solution if one turns
+// up within MOVE_BUDGET_NODE_LIMIT nodes (4x4 and smaller), else the length
+// of a reduction solution, plus HARD_MODE_SLACK percent.
+uint16_t puzzle_move_budget(const struct puzzle* p) {
+  Key path[SOLVER_MAX_DEPTH];
+  struct solver_config cfg = {
+    .heuristic = generator_heuristic(p->order),
+    .node_limit = MOVE_BUDGET_NODE_LIMIT,
+    .cache = solution_cache_get(),
+  };
+  int length = (p->order <= WD_ORDER) ? ida_star(p, path, &cfg, NULL) : SOLVER_FAILED;
+  if (length == SOLVER_FAILED) {
+    struct move_list solution = { 0 };
+    length = reduction_solve(p, &solution, true, NULL);
+    move_list_free(&solution);
+    if (length == SOLVER_FAILED) return HARD_MODE_MOVE_LIMIT;
+  }
+  int budget = length + length * HARD_MODE_SLACK / 100;
+  return (budget > UINT16_MAX) ? UINT16_MAX : budget;
+}
+
+uint16_t move_budget(const struct game_state* gs) {
+  if (gs->order > SOLVER_MAX_ORDER) return HARD_MODE_MOVE_LIMIT;
+  struct puzzle p;
+  puzzle_from_game_state(&p, gs);
+  return puzzle_move_budget(&p);
+}
+
+// deals a board for mode into gs, or a random one if the band couldn't be met.
+void populate_mat_for_mode(struct game_state* gs, Mode mode) {
+  struct puzzle p;
+  if (mode >= mode_easy && mode <= mode_hard && generate_in_band(&p, gs->order, mode_bands[mode], NULL)) {
+    puzzle_to_game_state(&p, gs);
+  } else {
+    populate_mat(gs);
+  }
+}
+
+// deals a new game of given mode into gs. the same seed always deals the
+// same game, which is what replays rely on (see replay.c).
+void deal_game(struct game_state* gs, Mode mode, uint32_t seed) {
+  srand(seed);
+  gs->mode = mode; // game_state_init() guesses it from the order, which custom boards share
+  if (mode == mode_custom) populate_mat(gs);
+  else populate_mat_for_mode(gs, mode);
+  gs->moves = 0;
+  gs->count_ctrl = count_up;
+  if (mode == mode_hard) { // hard mode has limited moves
+    gs->move_limit = move_budget(gs); // solver length plus some slack
+    gs->moves = gs->move_limit;
+    gs->count_ctrl = count_down;
+  }
+}
@@ -0,0 +1,200 @@
+/*
+Hints and auto-play.
+
+A background thread keeps a plan (a full solution) for the board the
+player is looking at, so asking for a hint never waits on a solver.
+
+  - every move the player makes is reported with hint_observe(). if it is
+    the move the plan expected, the plan is simply advanced (and undoing
+    that move steps it back), so following hints costs nothing.
+  - any other move cancels the running search and a new plan is computed
+    for the current board.
+
+Plans come from reduction_solve() first, since it answers within a few
+milliseconds at every order. On small boards the thread then looks for an
+optimal plan and swaps it in, as long as the player hasn't moved since.
+Boards that were solved optimally before, in this game or any other, are
+found in the solution cache (see solution_cache.c) and skip both.
+*/
+
+#pragma once
+
+#include "libunivoid.h"
+#include "solver.c"
+#include "reduction_solver.c"
+
+// nodes the optimal search may spend improving a hint plan.
+#define HINT_NODE_LIMIT 2000000
+
+// largest order for which optimal plans are attempted.
+#define HINT_OPTIMAL_ORDER 4
+
+struct hint_engine {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  bool started;
+  bool quit;
+  bool pending; // board holds a position waiting to be planned
+  struct puzzle board;
+  uint64_t generation; // bumped every time a new board is posted
+  atomic_bool cancel; // cancels the search in progress
+  bool ready; // plan is valid for the current board
+  struct move_list plan;
+  uint32_t cursor; // next move of the plan
+};
+
+// publishes plan if it still belongs to the latest board. returns false if it was stale.
+static bool hint_publish(struct hint_engine* he, struct move_list* plan, uint64_t generation, bool upgrade) {
+  bool published = false;
+  pthread_mutex_lock(&he->lock);
+  // an upgrade is only useful if the player hasn't moved along the old plan.
+  if (generation == he->generation && !he->pending && (!upgrade || he->cursor == 0)) {
+    move_list_free(&he->plan);
+    he->plan = *plan;
+    he->cursor = 0;
+    he->ready = true;
+    published = true;
+  }
+  pthread_mutex_unlock(&he->lock);
+  if (!published) move_list_free(plan);
+  return published;
+}
+
+static void* hint_worker(void* arg) {
+  struct hint_engine* he = arg;
+
+  pthread_mutex_lock(&he->lock);
+  while (true) {
+    while (!he->pending && !he->quit) pthread_cond_wait(&he->wake, &he->lock);
+    if (he->quit) break;
+    struct puzzle board = he->board;
+    uint64_t generation = he->generation;
+    he->pending = false;
+    atomic_store(&he->cancel, false);
+    pthread_mutex_unlock(&he->lock);
+
+    // hint_publish() takes ownership of the plan, published or not.
+    struct move_list plan = { 0 };
+    bool published = false, cached = false;
+    Key path[SOLVER_MAX_DEPTH];
+    struct solver_config cfg = {
+      .heuristic = heur_walking_distance,
+      .node_limit = HINT_NODE_LIMIT,
+      .cancel = &he->cancel,
+      .cache = solution_cache_get(),
+    };
+    // a board solved before (by any game) needs no solver at all.
+    int length = solver_cache_lookup(&board, path, &cfg, NULL);
+    if (length != SOLVER_FAILED) {
+      for (int i = 0; i < length; i++) move_list_push(&plan, path[i]);
+      published = hint_publish(he, &plan, generation, false);
+      cached = true;
+    } else if (reduction_solve(&board, &plan, true, &he->cancel) == SOLVER_FAILED) {
+      move_list_free(&plan);
+    } else {
+      published = hint_publish(he, &plan, generation, false);
+    }
+
+    if (published && !cached && board.order > 3 && board.order <= HINT_OPTIMAL_ORDER) {
+      length = ida_star(&board, path, &cfg, NULL);
+      if (length != SOLVER_FAILED) {
+        struct move_list optimal = { 0 };
+        for (int i = 0; i < length; i++) move_list_push(&optimal, path[i]);
+        hint_publish(he, &optimal, generation, true);
+      }
+    }
+    pthread_mutex_lock(&he->lock);
+  }
+  pthread_mutex_unlock(&he->lock);
+  return NULL;
+}
+
+// asks the worker to plan for the board in gs. lock must be held.
+static void hint_post(struct hint_engine* he, const struct game_state* gs) {
+  puzzle_from_game_state(&he->board, gs);
+  he->generation++;
+  he->pending = true;
+  he->ready = false;
+  atomic_store(&he->cancel, true);
+  pthread_cond_signal(&he->wake);
+}
+
+// the engine is only handed out by pointer, its layout stays private to the library.
+struct hint_engine* hint_engine_new() {
+  return calloc(1, sizeof(struct hint_engine));
+}
+
+// starts the worker and plans for the board in gs. an engine that was
+// stopped can be started again, everything the last run left is reset.
+void hint_engine_start(struct hint_engine* he, const struct game_state* gs) {
+  if (he->started || gs->order > HINT_MAX_ORDER) return;
+  pthread_mutex_init(&he->lock, NULL);
+  pthread_cond_init(&he->wake, NULL);
+  atomic_init(&he->cancel, false);
+  he->quit = false;
+  he->ready = false;
+  he->cursor = 0;
+  he->plan = (struct move_list) { 0 };
+  he->started = true;
+  pthread_mutex_lock(&he->lock);
+  hint_post(he, gs);
+  pthread_mutex_unlock(&he->lock);
+  pthread_create(&he->thread, NULL, hint_worker, he);
+}
+
+void hint_engine_stop(struct hint_engine* he) {
+  if (!he->started) return;
+  pthread_mutex_lock(&he->lock);
+  he->quit = true;
+  atomic_store(&he->cancel, true);
+  pthread_cond_signal(&he->wake);
+  pthread_mutex_unlock(&he->lock);
+  pthread_join(he->thread, NULL);
+  pthread_mutex_destroy(&he->lock);
+  pthread_cond_destroy(&he->wake);
+  move_list_free(&he->plan);
+  he->started = false;
+}
+
+// true if the n moves of the plan from i on are all key.
+static bool plan_repeats(const struct hint_engine* he, int64_t i, int n, Key key) {
+  if (i < 0 || i + n > he->plan.length) return false;
+  for (int j = 0; j < n; j++) {
+    if (he->plan.keys[i + j] != key) return false;
+  }
+  return true;
+}
+
+// tells the engine that key was applied to the board in gs. a slide
+// follows the plan if the plan moves the same way for as many tiles.
+void hint_observe(struct hint_engine* he, const struct game_state* gs, Key key) {
+  if (!he->started) return;
+  int tiles = key_tiles(key);
+  key = key_direction(key);
+  pthread_mutex_lock(&he->lock);
+  if (he->ready && plan_repeats(he, he->cursor, tiles, key)) {
+    he->cursor += tiles;
+  } else if (he->ready && plan_repeats(he, (int64_t)he->cursor - tiles, tiles, -key)) {
+    he->cursor -= tiles;
+  } else {
+    hint_post(he, gs);
+  }
+  pthread_mutex_unlock(&he->lock);
+}
+
+// returns the next move of the plan, key_invalid while it is still being computed.
+Key hint_next(struct hint_engine* he) {
+  Key key = key_invalid;
+  if (!he->started) return key;
+  pthread_mutex_lock(&he->lock);
+  if (he->ready && he->cursor < he->plan.length) key = he->plan.keys[he->cursor];
+  pthread_mutex_unlock(&he->lock);
+  return key;
+}
+
+void hint_engine_free(struct hint_engine* he) {
+  if (he == NULL) return;
+  hint_engine_stop(he);
+  free(he);
+}
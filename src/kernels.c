@@ -0,0 +1,193 @@
+/*
+Move and evaluation kernels of the game board, specialized per order.
+
+The board of a game_state is one flat array (gs->tiles, mat only points
+into it by rows), so a kernel can work on it with a stride that is a
+compile time constant. BOARD_KERNEL(N) stamps out the kernels of order N:
+
+  - move : mov_zero(). the cell the void-tile moves into is looked up in
+           a table of every cell and key instead of checking the edges.
+  - is_sorted : is_sorted(), a loop of constant length.
+  - manhattan : sum of the manhattan distances of all tiles, looked up
+                in a table of every tile and cell.
+
+Slides of several tiles (see slide_key()) aren't worth a kernel per
+order, every move kernel hands them to slide_zero() on the way out.
+
+Orders 3, 4 and 5 (easy, normal and hard) get their own kernels, any
+other order uses the generic ones, which read the order from gs. The
+kernel of a game is picked once by game_state_init(), every call after
+that goes straight to it.
+
+  target/bench compares them, see the *_generic rows.
+*/
+
+#pragma once
+
+#include <pthread.h>
+#include "../lib/uni-void.c"
+#include "zobrist.c"
+
+struct board_kernel {
+  int order; // 0 for the generic kernel
+  Counter (*move)(struct game_state* gs, Key key);
+  bool (*is_sorted)(const struct game_state* gs);
+  int (*manhattan)(const struct game_state* gs);
+};
+
+// keys index the move tables as key + 2, anything but a move lands on -1.
+#define KERNEL_KEYS 5
+
+// fills the tables of an order: the cell the void-tile moves into from
+// every cell on every key (-1 off the edge), and the distance of every
+// tile on every cell from its goal cell.
+static void kernel_tables_fill(int order, int16_t* target, uint8_t* distance) {
+  int size = order * order;
+  for (int cell = 0; cell < size; cell++) {
+    int x = cell / order, y = cell % order;
+    int16_t* t = target + cell * KERNEL_KEYS;
+    for (int k = 0; k < KERNEL_KEYS; k++) t[k] = -1;
+    if (x > 0) t[key_up + 2] = cell - order;
+    if (x < order - 1) t[key_down + 2] = cell + order;
+    if (y > 0) t[key_left + 2] = cell - 1;
+    if (y < order - 1) t[key_right + 2] = cell + 1;
+    for (int tile = 1; tile < size; tile++) {
+      distance[tile * size + cell] = abs(x - (tile - 1) / order) + abs(y - (tile - 1) % order);
+    }
+  }
+}
+
+// moves the void-tile several cells at once, every tile in between slides
+// one cell toward where it was. a row is shifted with one memmove(), a
+// column with a strided copy. all or nothing: count_stop if there is no
+// room for every tile (see slide_clamp()) or key isn't a slide.
+static Counter slide_zero(struct game_state* gs, Key key) {
+  int tiles = key_tiles(key), order = gs->order, step;
+  int x = gs->curs_x, y = gs->curs_y;
+  if (tiles < 2) return count_stop;
+  switch (key_direction(key)) {
+    case key_up : if (x < tiles) return count_stop; step = -order; break;
+    case key_down : if (x + tiles >= order) return count_stop; step = order; break;
+    case key_left : if (y < tiles) return count_stop; step = -1; break;
+    case key_right : if (y + tiles >= order) return count_stop; step = 1; break;
+    default : return count_stop;
+  }
+  int* t = gs->tiles;
+  int zero = x * order + y, end = zero + tiles * step;
+  // the void-tile's keys of the cells in between cancel out, only where
+  // it starts and ends are left.
+  uint64_t hash = gs->hash ^ zobrist_key(0, zero) ^ zobrist_key(0, end);
+  for (int cell = zero; cell != end; cell += step) hash ^= zobrist_key(t[cell + step], cell + step) ^ zobrist_key(t[cell + step], cell);
+  gs->hash = hash;
+  if (step == 1) memmove(t + zero, t + zero + 1, sizeof(int) * tiles);
+  else if (step == -1) memmove(t + end + 1, t + end, sizeof(int) * tiles);
+  else for (int cell = zero; cell != end; cell += step) t[cell] = t[cell + step];
+  t[end] = 0;
+  gs->curs_x = end / order;
+  gs->curs_y = end % order;
+  return gs->count_ctrl;
+}
+
+#define BOARD_KERNEL(N) \
+  static int16_t kernel_target_##N[N * N][KERNEL_KEYS]; \
+  static uint8_t kernel_distance_##N[N * N][N * N]; /* [tile][cell], 0 for the void */ \
+  \
+  static Counter kernel_move_##N(struct game_state* gs, Key key) { \
+    if ((unsigned)(key + 2) >= KERNEL_KEYS) return slide_zero(gs, key); \
+    int zero = gs->curs_x * N + gs->curs_y, target = kernel_target_##N[zero][key + 2]; \
+    if (target < 0) return count_stop; \
+    int* tiles = gs->tiles; \
+    gs->hash ^= zobrist_slide(tiles[target], target, zero); \
+    tiles[zero] = tiles[target]; \
+    tiles[target] = 0; \
+    gs->curs_x = target / N; \
+    gs->curs_y = target % N; \
+    return gs->count_ctrl; \
+  } \
+  \
+  static bool kernel_is_sorted_##N(const struct game_state* gs) { \
+    const int* tiles = gs->tiles; \
+    int zero = gs->curs_x * N + gs->curs_y, count = 0; \
+    for (int cell = 0; cell < N * N; cell++) { \
+      if (cell != zero && tiles[cell] != ++count) return false; \
+    } \
+    return true; \
+  } \
+  \
+  static int kernel_manhattan_##N(const struct game_state* gs) { \
+    int md = 0; \
+    for (int cell = 0; cell < N * N; cell++) md += kernel_distance_##N[gs->tiles[cell]][cell]; \
+    return md; \
+  } \
+  \
+  static const struct board_kernel board_kernel_##N = { N, kernel_move_##N, kernel_is_sorted_##N, kernel_manhattan_##N };
+
+BOARD_KERNEL(3)
+BOARD_KERNEL(4)
+BOARD_KERNEL(5)
+
+static Counter kernel_move_generic(struct game_state* gs, Key key) {
+  int x = gs->curs_x, y = gs->curs_y;
+  switch (key) {
+    case key_up :
+      if (x == 0) return count_stop; else x--; break;
+    case key_down :
+      if (x == gs->order - 1) return count_stop; else x++; break;
+    case key_right :
+      if (y == gs->order - 1) return count_stop; else y++; break;
+    case key_left :
+      if (y == 0) return count_stop; else y--; break;
+    default : return slide_zero(gs, key);
+  }
+
+  // the tile at (x, y) slides into the old position of the void-tile.
+  gs->hash ^= zobrist_slide(gs->mat[x][y], x * gs->order + y, gs->curs_x * gs->order + gs->curs_y);
+  gs->mat[gs->curs_x][gs->curs_y] = gs->mat[x][y];
+  gs->mat[x][y] = 0;
+  gs->curs_x = x;
+  gs->curs_y = y;
+  return gs->count_ctrl;
+}
+
+static bool kernel_is_sorted_generic(const struct game_state* gs) {
+  int count = 0;
+  for (int i = 0; i < gs->order; i++) {
+    for (int j = 0; j < gs->order; j++) {
+      if (i == gs->curs_x && j == gs->curs_y) continue;
+      if (gs->mat[i][j] != ++count) return false;
+    }
+  }
+  return true;
+}
+
+static int kernel_manhattan_generic(const struct game_state* gs) {
+  int md = 0;
+  for (int i = 0; i < gs->order; i++) {
+    for (int j = 0; j < gs->order; j++) {
+      int tile = gs->mat[i][j];
+      if (tile != 0) md += abs(i - (tile - 1) / gs->order) + abs(j - (tile - 1) % gs->order);
+    }
+  }
+  return md;
+}
+
+const struct board_kernel board_kernel_generic = { 0, kernel_move_generic, kernel_is_sorted_generic, kernel_manhattan_generic };
+
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+
+static void kernel_tables_init() {
+  kernel_tables_fill(3, &kernel_target_3[0][0], &kernel_distance_3[0][0]);
+  kernel_tables_fill(4, &kernel_target_4[0][0], &kernel_distance_4[0][0]);
+  kernel_tables_fill(5, &kernel_target_5[0][0], &kernel_distance_5[0][0]);
+}
+
+// returns the kernels for boards of given order.
+const struct board_kernel* board_kernel_for(int order) {
+  pthread_once(&kernel_once, kernel_tables_init);
+  switch (order) {
+    case 3 : return &board_kernel_3;
+    case 4 : return &board_kernel_4;
+    case 5 : return &board_kernel_5;
+    default : return &board_kernel_generic;
+  }
+}
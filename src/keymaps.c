@@ -1,6 +1,7 @@
 #pragma once
 
-#include "../lib/uni-void.c"
+#include <ncurses.h>
+#include "libunivoid.h"
 
 Key decode_key(int ch) {
   switch (ch) {
@@ -15,7 +16,38 @@ Key decode_key(int ch) {
     case 'Q' : return key_force_quit;
     case KEY_RESIZE : return key_resize;
     case '?' : return key_usage;
+    case 'i' : return key_hint;
+    case 'p' : return key_autoplay;
+    case 't' : return key_stats;
+    case '[' : return key_step_back;
+    case ']' : return key_step_forward;
+    case 'g' : return key_jump;
   }
   return key_invalid;
 }
 
+// decode_key() with a vim style count in front of moves: "5l" slides five
+// tiles at once, see slide_key(). digits only add up in *count and give
+// key_invalid, any other key uses the count up.
+Key decode_counted_key(int ch, int* count) {
+  if (ch >= '0' && ch <= '9' && (ch != '0' || *count > 0)) {
+    if (*count < CUSTOM_MAX_ORDER) *count = *count * 10 + (ch - '0');
+    return key_invalid;
+  }
+  Key key = decode_key(ch);
+  if (key == key_up || key == key_down || key == key_left || key == key_right) key = slide_key(key, *count);
+  *count = 0;
+  return key;
+}
+
+// message shown on the status line for a hinted move.
+char* hint_message(Key key) {
+  switch (key) {
+    case key_up : return "hint: move up";
+    case key_down : return "hint: move down";
+    case key_left : return "hint: move left";
+    case key_right : return "hint: move right";
+    default : return "thinking...";
+  }
+}
+
@@ -16,26 +16,17 @@ here is the structure of csv file:
 */
 #pragma once 
 
-#include "../lib/uni-void.c"
+#include "libunivoid.h"
 #include "../lib/arena.c"
 #include "csv_parser.c"
 #include "utils.c"
+#include "leaderboard_cache.c"
 
-// maximum number of lines when printing leaderboard
-#define LEADERBOARD_ENTRIES 8
-
-static Arena* csv_arena;
-
-// csv structure
- struct leaderboard_record {
-  uint16_t order;
-  uint16_t moves;
-  char *player_name;
-  time_t time;
-};
+// records are parsed into this arena, see libunivoid.h
+Arena* csv_arena;
 
 // // initialize leaderboard type
-static struct leaderboard_record leader_board_init(uint16_t order, uint16_t moves, char* name, time_t time) {
+struct leaderboard_record leader_board_init(uint16_t order, uint16_t moves, char* name, time_t time) {
   return (struct leaderboard_record) {
     .order = order,
     .moves = moves,
@@ -74,7 +65,7 @@ static struct leaderboard_record parse_next_leaderboard_entry(String* lexer, Tok
 // parses all entries if order is 0. otherwise only parse records with given order.
 // this way, a single file can be used to store records of all game modes.
 // returns number of records read from file.
-static uint32_t load_leaderboard(struct leaderboard_record *records, uint16_t order) {
+uint32_t load_leaderboard(struct leaderboard_record *records, uint16_t order) {
   FILE* fp = fopen(LEADERBOARD_FILE, "r");
   if (fp == NULL) {
     return 0;
@@ -87,7 +78,7 @@ static uint32_t load_leaderboard(struct leaderboard_record *records, uint16_t or
   struct leaderboard_record tmp_record = parse_next_leaderboard_entry(&file, tokens, record_len);
   uint16_t j = 0;
   if (order == 0) { // parse all records.
-    while (tmp_record.order != 0) {
+    while (j < LEADERBOARD_MAX_RECORDS && tmp_record.order != 0) {
       records[j++] = tmp_record;
       tmp_record = parse_next_leaderboard_entry(&file, tokens, record_len);
     }
@@ -105,10 +96,81 @@ static uint32_t load_leaderboard(struct leaderboard_record *records, uint16_t or
   return j;
 }
 
+// true if line looks like a record: 4 non-empty fields, the first one a
+// number. keeps headers, comments and mangled lines away from the parser,
+// which expects well formed rows.
+static bool leaderboard_line_ok(const char* line, size_t n) {
+  int fields = 1;
+  bool quoting = false, empty = true;
+  if (n == 0 || line[0] < '0' || line[0] > '9') return false;
+  for (size_t i = 0; i < n && line[i] != '\n'; i++) {
+    if (line[i] == '"') quoting = !quoting;
+    if (line[i] == ',' && !quoting) {
+      if (empty) return false;
+      fields++;
+      empty = true;
+    } else if (!is_whitespace(line[i])) {
+      empty = false;
+    }
+  }
+  return fields == 4 && !empty && !quoting;
+}
+
+static bool is_number(const String* s) {
+  if (s->length == 0 || s->length > 18) return false;
+  for (size_t i = 0; i < s->length; i++) {
+    if (s->str[i] < '0' || s->str[i] > '9') return false;
+  }
+  return true;
+}
+
+// reads the leaderboard csv from fp one line at a time and calls visit on
+// every record, so files of any size are read in constant memory. the
+// player name of a record is only valid during the call. lines that
+// aren't records are counted into *skipped.
+// returns the number of records visited.
+uint64_t stream_leaderboard(FILE* fp, void (*visit)(const struct leaderboard_record* record, void* ctx), void* ctx, uint64_t* skipped) {
+  char* buf = NULL, name[LEADERBOARD_NAME_MAX];
+  size_t size = 0;
+  ssize_t n;
+  uint64_t visited = 0;
+  Token tokens[4];
+  *skipped = 0;
+
+  while ((n = getline(&buf, &size, fp)) > 0) {
+    if (buf[0] == '"' || buf[0] == '#' || buf[0] == '\n') continue; // header, comments and empty lines
+    if (!leaderboard_line_ok(buf, n)) {
+      (*skipped)++;
+      continue;
+    }
+    if (buf[n - 1] != '\n') buf[n++] = '\n'; // the last line, getline() left room for its 0
+    if (n > 1 && buf[n - 2] == '\r') buf[--n - 1] = '\n'; // edited on windows
+    String line = { .str = buf, .length = n, .capacity = n };
+    if (parse_next_record(&line, tokens, 4) != OK || !is_number(&tokens[0].lexeme) ||
+        !is_number(&tokens[1].lexeme) || !is_number(&tokens[3].lexeme)) {
+      (*skipped)++;
+      continue;
+    }
+    size_t len = (tokens[2].lexeme.length < sizeof(name)) ? tokens[2].lexeme.length : sizeof(name) - 1;
+    memcpy(name, tokens[2].lexeme.str, len);
+    name[len] = '\0';
+    struct leaderboard_record record = leader_board_init(
+      str_to_int64(&tokens[0].lexeme),
+      str_to_int64(&tokens[1].lexeme),
+      name,
+      str_to_int64(&tokens[3].lexeme)
+    );
+    visit(&record, ctx);
+    visited++;
+  }
+  free(buf);
+  return visited;
+}
+
 // sort the records based on moves. ordering can be specified by passing the
 // order_dec or order_asc functions as parameter. implements insertion sort since
 // total number of records will be very small.
-static void sort_records_using_moves(struct leaderboard_record* records, size_t size, bool (*order_by)(uint16_t, uint16_t)) {
+void sort_records_using_moves(struct leaderboard_record* records, size_t size, bool (*order_by)(uint16_t, uint16_t)) {
   for (int i = 0; i < size; i++) {
     struct leaderboard_record key = records[i];
     int j = i - 1;
@@ -121,12 +183,17 @@ static void sort_records_using_moves(struct leaderboard_record* records, size_t
 }
 
 // saves new_record at the top of the file and deletes last entry if
-// number of records exceeds max_records.
-static void save_record(const struct leaderboard_record* new_record) {
+// number of records exceeds max_records. the rows come from the shared
+// cache when it holds the file, and the rows written go back to it, see
+// leaderboard_cache.c
+void save_record(const struct leaderboard_record* new_record) {
   uint16_t max_records = LEADERBOARD_ENTRIES * 4;
   struct leaderboard_record *all_records = arena_alloc(csv_arena, sizeof(struct leaderboard_record) * max_records);  
   all_records[0] = *new_record; // first record is new_record.
-  size_t read_entries = load_leaderboard(all_records + 1, 0); // parses the file
+  uint32_t read_entries;
+  if (!leaderboard_cache_load(0, csv_arena, all_records + 1, &read_entries)) {
+    read_entries = load_leaderboard(all_records + 1, 0); // parses the file
+  }
   if (read_entries < max_records - 1) {
     read_entries++; // makes room for new_record only if total entries in our file doesn't exceeds max_records limit
   }
@@ -142,74 +209,22 @@ static void save_record(const struct leaderboard_record* new_record) {
   for (size_t i = 0; i < read_entries; i++) {
     fprintf(fp, "%d,%d,\"%s\",%lu\n", all_records[i].order, all_records[i].moves, all_records[i].player_name, all_records[i].time);
   }
+  struct stat st;
+  bool written = fflush(fp) == 0 && fstat(fileno(fp), &st) == 0;
   fclose(fp);
+  if (written) leaderboard_cache_publish(all_records, read_entries, &st);
 }
 
-// saves new entry to csv file and display leaderboard.
-void display_leaderboards(const struct game_state* gs, char* name) {
-  csv_arena = err_expect(arena_err, arena_init(1024)); // initializes new arena context
-  char* player_name = strdup(name);
-  struct leaderboard_record new_record = leader_board_init(gs->order, gs->moves, player_name, time(NULL));
-  save_record(&new_record);
-
-  struct leaderboard_record *records = arena_alloc(csv_arena, sizeof(struct leaderboard_record) * LEADERBOARD_ENTRIES);
-
-  size_t read_records_count = load_leaderboard(records, gs->order);
-
-  if (read_records_count) {
-    int rank = 0;
-    sort_records_using_moves(records, read_records_count, (gs->mode == mode_hard) ? order_dec : order_asc);
-    for (int i = 0; i < read_records_count; i++) {
-      if (strcmp(records[i].player_name, player_name) == 0 && records[i].moves == new_record.moves) {
-        rank = i;
-        break;
-      }
-    }
-
-    char *mode;
-    switch (gs->mode) {
-      case mode_easy: mode = "Easy"; break;
-      case mode_normal: mode = "Normal"; break;
-      case mode_hard: mode = "Hard"; break;
-      default: mode = "Custom"; break; 
-    }
-
-    erase();
-    char* template = "#  Moves   Player          Time     ";
-    int y = CENTER_Y(read_records_count + 3);
-    int x = CENTER_X(strlen("6. 35	   hariii          12-03-2025 21:36:12"));
-
-    attron(A_BOLD);
-    mvprintw(y++, x, "Congrats %s! you are #%d", player_name, rank + 1);
-    attroff(A_BOLD);
-    y++;
-    attron(A_DIM);
-    mvprintw(y++, x, "Leaderboard (%s){%dx%d}", mode, new_record.order, new_record.order);
-    attroff(A_DIM);
-    mvchgat(y - 1, x, strlen("Leaderboard"), A_UNDERLINE, 0, NULL);
-    mvprintw(y++, x, "%s", template);
-
-    struct tm *ctime;
-    for (int i = 0; i < read_records_count; i++) {
-      ctime = localtime(&records[i].time);
-      mvprintw(y, x, "%d. %d", i + 1, records[i].moves);
-      mvprintw(y, x + 11, "%s", records[i].player_name);
-      mvprintw(y, x + 26,
-               " %02d-%02d-%4d %02d:%02d:%02d",
-               ctime->tm_mday,
-               ctime->tm_mon + 1,
-               ctime->tm_year + 1900,
-               ctime->tm_hour,
-               ctime->tm_min,
-               ctime->tm_sec
-             );
-      if (i == rank) {
-        mvchgat(y, x, -1, A_BOLD, 0, NULL);
-      }
-      y++;
-    }
+// adds new_record to the file and reads the leaderboard of its order back
+// into records (room for LEADERBOARD_ENTRIES), fewest moves first. rows
+// keep the moves used in every mode, see moves_used().
+// returns the number of records read.
+uint32_t submit_record(const struct leaderboard_record* new_record, Mode mode, struct leaderboard_record* records) {
+  save_record(new_record);
+  uint32_t read_records_count;
+  if (!leaderboard_cache_load(new_record->order, csv_arena, records, &read_records_count)) {
+    read_records_count = load_leaderboard(records, new_record->order);
   }
-
-  free(player_name);
-  arena_free(csv_arena);
+  sort_records_using_moves(records, read_records_count, order_asc);
+  return read_records_count;
 }
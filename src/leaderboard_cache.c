@@ -0,0 +1,190 @@
+/*
+A parsed copy of the leaderboard file in POSIX shared memory, shared by
+every process that plays from the same game_files/.
+
+save_record() has every row of the file in memory when it rewrites it,
+so it publishes them here as well, in file order. Both reads of a
+finished game then come from the segment instead of the file:
+save_record() takes the rows it rewrites from it, and submit_record()
+the rows of its order. leaderboard_cache_load() picks rows exactly the
+way load_leaderboard() does, sorting is left to the caller like for
+parsed rows. The file is only parsed when the segment can't be used:
+the first game after a boot or after a hand edit, or when a name is too
+long to keep.
+
+The segment is named after the user and the device and inode of the
+leaderboard file, so players started from different directories on the
+same file share it. It is private to the user: created 0600, and a
+segment owned by anyone else or open to others is never used. Its
+contents are checked before use all the same, a reader that finds
+counts out of range parses the file instead. A process that finds the
+file replaced (another inode, or none) unlinks the segment of the old
+one, so /dev/shm doesn't collect segments of files long gone. Access
+goes through a seqlock:
+
+  - a writer holds flock() on the segment, so there is one at a time even
+    across processes. it makes seq odd, writes, and makes it even again.
+    a writer that died halfway leaves seq odd, the next one simply
+    finishes the job.
+  - a reader copies what it needs and checks that seq was even and didn't
+    change meanwhile. it never waits: after LEADERBOARD_CACHE_TRIES torn
+    reads it gives up and the caller parses the file.
+
+The cache remembers the size and mtime of the file it was built from and
+a reader only trusts it while the file still matches, so hand edits of
+the leaderboard (encouraged, see leaderboard.c) are never hidden.
+*/
+
+#pragma once
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "libunivoid.h"
+#include "../lib/arena.c"
+
+#define LEADERBOARD_CACHE_MAGIC 0x756e69766f69646cULL // "univoidl"
+#define LEADERBOARD_CACHE_VERSION 3 // bumped whenever the layout changes
+#define LEADERBOARD_CACHE_TRIES 64
+
+struct cached_record {
+  uint16_t order;
+  uint16_t moves;
+  int64_t time;
+  char name[LEADERBOARD_NAME_MAX];
+};
+
+struct leaderboard_cache {
+  _Atomic uint64_t seq; // odd while a writer is at it
+  uint64_t magic; // 0 until the first publish
+  uint32_t version;
+  // the file the cache was built from
+  int64_t size;
+  int64_t mtime_sec, mtime_nsec;
+  uint32_t n_records;
+  struct cached_record records[LEADERBOARD_MAX_RECORDS]; // every row of the file, in file order
+};
+
+static struct leaderboard_cache* cache; // mapped on first use
+static int cache_fd = -1;
+static char cache_name[80]; // of the mapped segment
+
+// unmaps the segment, and removes it if its file is gone.
+static void leaderboard_cache_unmap(bool file_gone) {
+  if (cache == NULL) return;
+  munmap(cache, sizeof(struct leaderboard_cache));
+  close(cache_fd);
+  if (file_gone) shm_unlink(cache_name);
+  cache = NULL;
+}
+
+// maps the segment of the leaderboard file st describes, creating it if
+// needed. returns NULL if shared memory isn't available.
+static struct leaderboard_cache* leaderboard_cache_map(const struct stat* st) {
+  static dev_t dev;
+  static ino_t ino;
+  if (cache != NULL && dev == st->st_dev && ino == st->st_ino) return cache;
+  // the file is always opened by the same path, another inode means the
+  // one of the mapped segment was replaced.
+  leaderboard_cache_unmap(true);
+  snprintf(cache_name, sizeof(cache_name), "/uni-void-leaderboard-%lu-%lx-%lx",
+           (unsigned long)getuid(), (unsigned long)st->st_dev, (unsigned long)st->st_ino);
+  if ((cache_fd = shm_open(cache_name, O_RDWR | O_CREAT, 0600)) < 0) return NULL;
+  struct stat shm;
+  // a fresh segment is zero filled, which reads as never published. one
+  // someone else could write to is left alone.
+  if (fstat(cache_fd, &shm) != 0 || shm.st_uid != getuid() || (shm.st_mode & 077) != 0 ||
+      (shm.st_size < (off_t)sizeof(struct leaderboard_cache) && ftruncate(cache_fd, sizeof(struct leaderboard_cache)) != 0)) {
+    close(cache_fd);
+    return NULL;
+  }
+  void* mem = mmap(NULL, sizeof(struct leaderboard_cache), PROT_READ | PROT_WRITE, MAP_SHARED, cache_fd, 0);
+  if (mem == MAP_FAILED) {
+    close(cache_fd);
+    return NULL;
+  }
+  cache = mem;
+  dev = st->st_dev;
+  ino = st->st_ino;
+  return cache;
+}
+
+static bool leaderboard_cache_matches(const struct leaderboard_cache* c, const struct stat* st) {
+  return c->magic == LEADERBOARD_CACHE_MAGIC && c->version == LEADERBOARD_CACHE_VERSION && c->size == st->st_size &&
+         c->mtime_sec == st->st_mtim.tv_sec && c->mtime_nsec == st->st_mtim.tv_nsec;
+}
+
+// replaces the cache with records, the rows of the leaderboard file in
+// file order. st is the file as it was right after they were written.
+void leaderboard_cache_publish(const struct leaderboard_record* records, size_t n, const struct stat* st) {
+  struct leaderboard_cache* c = leaderboard_cache_map(st);
+  if (c == NULL || flock(cache_fd, LOCK_EX) != 0) return;
+
+  uint64_t seq = atomic_load_explicit(&c->seq, memory_order_relaxed) | 1;
+  atomic_store_explicit(&c->seq, seq, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  // rows that don't fit leave the cache unpublished. save_record() would
+  // write them back cut short otherwise.
+  bool fits = n <= LEADERBOARD_MAX_RECORDS;
+  for (size_t i = 0; i < n && fits; i++) {
+    struct cached_record* r = &c->records[i];
+    r->order = records[i].order;
+    r->moves = records[i].moves;
+    r->time = records[i].time;
+    fits = snprintf(r->name, sizeof(r->name), "%s", records[i].player_name) < (int)sizeof(r->name);
+  }
+  c->n_records = n;
+  c->size = st->st_size;
+  c->mtime_sec = st->st_mtim.tv_sec;
+  c->mtime_nsec = st->st_mtim.tv_nsec;
+  c->version = LEADERBOARD_CACHE_VERSION;
+  c->magic = fits ? LEADERBOARD_CACHE_MAGIC : 0;
+
+  atomic_store_explicit(&c->seq, seq + 1, memory_order_release);
+  flock(cache_fd, LOCK_UN);
+}
+
+// reads rows of the leaderboard from the cache into records the way
+// load_leaderboard() reads them from the file: every row (room for
+// LEADERBOARD_MAX_RECORDS) if order is 0, otherwise the first
+// LEADERBOARD_ENTRIES rows of order. names are allocated in arena.
+// returns false if the cache can't be trusted, the caller parses the file then.
+bool leaderboard_cache_load(uint16_t order, Arena* arena, struct leaderboard_record* records, uint32_t* count) {
+  struct stat st;
+  if (stat(LEADERBOARD_FILE, &st) != 0) {
+    leaderboard_cache_unmap(true);
+    return false;
+  }
+  struct leaderboard_cache* c = leaderboard_cache_map(&st);
+  if (c == NULL) return false;
+
+  struct cached_record copy[LEADERBOARD_MAX_RECORDS];
+  for (int tries = 0; tries < LEADERBOARD_CACHE_TRIES; tries++) {
+    uint64_t seq = atomic_load_explicit(&c->seq, memory_order_acquire);
+    if (seq & 1) continue;
+    bool matches = leaderboard_cache_matches(c, &st);
+    uint32_t n = c->n_records;
+    matches = matches && n <= LEADERBOARD_MAX_RECORDS;
+    if (matches) memcpy(copy, c->records, sizeof(struct cached_record) * n);
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&c->seq, memory_order_relaxed) != seq) continue; // torn, a writer got in
+    if (!matches) return false;
+
+    uint32_t max = (order == 0) ? LEADERBOARD_MAX_RECORDS : LEADERBOARD_ENTRIES;
+    *count = 0;
+    for (uint32_t i = 0; i < n && *count < max; i++) {
+      // load_leaderboard() stops at a row of order 0, ours never have one.
+      if (copy[i].order == 0 || memchr(copy[i].name, '\0', LEADERBOARD_NAME_MAX) == NULL) return false;
+      if (order != 0 && copy[i].order != order) continue;
+      char* name = arena_alloc(arena, strlen(copy[i].name) + 1);
+      if (name == NULL) return false;
+      strcpy(name, copy[i].name);
+      records[(*count)++] = (struct leaderboard_record) { copy[i].order, copy[i].moves, name, copy[i].time };
+    }
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,18 @@
+/*
+The translation unit behind target/libunivoid.a, see libunivoid.h.
+
+  ./build.sh builds it with -c and archives the object, the game and the
+  benchmarks link against the archive.
+*/
+
+#include "libunivoid.h"
+#include "utils.c"
+#include "save_and_load.c"
+#include "leaderboard.c"
+#include "hint.c"
+#include "state_space.c"
+#include "generator.c"
+#include "replay.c"
+#include "timeline.c"
+#include "server.c"
+#include "commands.c"
@@ -0,0 +1,248 @@
+/*
+libunivoid: the game core, without any terminal code.
+
+Everything that makes the game (moves, undo/redo, dealing boards,
+saving, replays, the leaderboard file, hints and the headless commands)
+is compiled from src/libunivoid.c into target/libunivoid.a. The ncurses
+front end (main.c, view.c, keymaps.c) and the benchmarks only include
+this header and link against the archive, so the core never pulls in
+ncurses and can be driven by other front ends.
+
+The core modules are still plain .c files included into one translation
+unit, the library is simply that unit. This header is included first
+there, so every prototype below is checked against its definition.
+*/
+
+#pragma once
+
+// build.sh compiles with strict -std=c23, which hides everything beyond
+// iso c in the system headers. every translation unit includes this
+// header first, so this is where the posix parts are asked for.
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include "../lib/uni-void.c" // macros, keys, modes and struct game_state
+
+// lib/arena.c
+typedef struct Arena Arena;
+Arena *arena_init(uint64_t capacity); // NULL on failure
+void *arena_alloc(Arena *arena, uint64_t size);
+void arena_free(Arena *arena);
+
+// utils.c
+struct game_state game_state_init(Arena* arena, int order);
+void push_key(Key stk[], int16_t *top, Key key);
+Key pop_key(Key stk[], int16_t *top);
+void unpop_key(struct game_state* gs, Key action, Key key);
+void make_radomized_array(int* arr, size_t size);
+Key slide_key(Key dir, int tiles);
+int key_tiles(Key key);
+Key key_direction(Key key);
+Key slide_clamp(const struct game_state* gs, Key key);
+void update_moves(struct game_state* gs, Key key);
+uint16_t moves_used(const struct game_state* gs);
+bool is_sorted(const struct game_state* gs);
+int game_state_manhattan(const struct game_state* gs);
+bool is_solvable(int* list, int order);
+uint64_t game_state_hash(const struct game_state* gs);
+void populate_mat(struct game_state* gs);
+Counter mov_zero(struct game_state* gs, Key key);
+double monotonic_seconds();
+
+// kernels.c, picked by game_state_init() for the order of the board.
+struct board_kernel;
+extern const struct board_kernel board_kernel_generic; // works for any order
+const struct board_kernel* board_kernel_for(int order);
+
+// generator.c
+void deal_game(struct game_state* gs, Mode mode, uint32_t seed);
+
+// replay.c
+struct replay {
+  uint32_t seed;
+  uint8_t mode; // mode the board was dealt for
+  uint8_t order;
+  int64_t finished; // time the game was won, 0 while it is being played
+  uint32_t length; // moves recorded
+  uint32_t capacity; // moves that fit in the packed array
+  uint8_t* moves; // 2 bits a move
+  uint32_t n_marks;
+  uint32_t marks_capacity;
+  uint32_t* marks; // undo and redo moves, (index << 1 | is_redo)
+  uint32_t n_slides;
+  uint32_t slides_capacity;
+  uint32_t* slides; // moves made by one slide, pairs of (first index, tiles)
+};
+
+struct replay replay_init(uint32_t seed, Mode mode, int order);
+void replay_free(struct replay* r);
+void replay_record(struct replay* r, Key key, Key action);
+bool replay_save(struct replay* r, int64_t finished);
+Key replay_move(const struct replay* r, uint32_t i);
+
+// timeline.c, boards of past steps rebuilt from checkpoints and a replay.
+struct timeline {
+  int order; // 0 if the game has none
+  uint32_t interval; // steps between checkpoints
+  uint32_t count; // checkpoints held, the i-th is the board at step i * interval
+  uint32_t capacity;
+  uint16_t* boards; // count boards of order * order tiles
+};
+
+bool timeline_init(struct timeline* tl, const struct replay* r, const struct game_state* gs);
+void timeline_record(struct timeline* tl, const struct replay* r, const struct game_state* gs);
+void timeline_seek(const struct timeline* tl, const struct replay* r, uint32_t step, struct game_state* gs);
+void timeline_free(struct timeline* tl);
+
+// save_and_load.c
+void save_game_state(struct game_state* gs, const struct replay* replay);
+struct game_state load_game_state(Arena* arena, struct replay* replay);
+
+// leaderboard.c
+
+// maximum number of lines when printing leaderboard
+#define LEADERBOARD_ENTRIES 8
+
+// the file never holds more records than this, see save_record()
+#define LEADERBOARD_MAX_RECORDS (LEADERBOARD_ENTRIES * 4 - 1)
+
+// longer player names are cut short by stream_leaderboard()
+#define LEADERBOARD_NAME_MAX 64
+
+// csv structure
+struct leaderboard_record {
+  uint16_t order;
+  uint16_t moves;
+  char *player_name;
+  time_t time;
+};
+
+// player names of parsed records live here. set it up before loading or
+// saving records and free it once they aren't needed anymore.
+extern Arena* csv_arena;
+
+struct leaderboard_record leader_board_init(uint16_t order, uint16_t moves, char* name, time_t time);
+uint32_t load_leaderboard(struct leaderboard_record *records, uint16_t order);
+void save_record(const struct leaderboard_record* new_record);
+bool order_dec(uint16_t a, uint16_t b);
+bool order_asc(uint16_t a, uint16_t b);
+void sort_records_using_moves(struct leaderboard_record* records, size_t size, bool (*order_by)(uint16_t, uint16_t));
+uint32_t submit_record(const struct leaderboard_record* new_record, Mode mode, struct leaderboard_record* records);
+uint64_t stream_leaderboard(FILE* fp, void (*visit)(const struct leaderboard_record* record, void* ctx), void* ctx, uint64_t* skipped);
+
+// analytics.c
+bool leaderboard_stats(const char* path, bool json);
+
+// merge.c
+struct merge_stats {
+  uint64_t records; // rows read from the inputs
+  uint64_t skipped; // lines that weren't records
+  uint64_t duplicates;
+  uint64_t dropped; // past the rows kept for their order
+  uint64_t written;
+  uint32_t runs; // sorted runs, one per input unless it was huge
+};
+bool merge_leaderboards(const char* output, char* const inputs[], int n_inputs, uint32_t keep, struct merge_stats* stats);
+
+// batch_eval.c, manhattan distance and linear conflicts of many boards.
+
+// tiles are bytes in a batch, which covers 16x16.
+#define BATCH_MAX_ORDER 16
+
+struct board_batch {
+  int order;
+  uint32_t count; // boards added
+  uint32_t capacity; // a multiple of the vector width
+  uint8_t* tiles; // tile of cell c of board i is tiles[c * capacity + i]
+  uint16_t* md; // manhattan distance of every board, set by board_batch_eval()
+  uint16_t* lc; // line conflicts of every board, the heuristic is md + 2 * lc
+};
+
+bool board_batch_init(struct board_batch* b, int order, uint32_t capacity);
+void board_batch_free(struct board_batch* b);
+bool board_batch_add(struct board_batch* b, const uint8_t* tiles);
+void board_batch_eval(struct board_batch* b);
+void board_batch_eval_scalar(struct board_batch* b);
+const char* board_batch_isa();
+
+// hint.c
+
+// boards larger than this get no hints, the solvers don't go beyond.
+#define HINT_MAX_ORDER 16
+
+struct hint_engine;
+struct hint_engine* hint_engine_new();
+void hint_engine_free(struct hint_engine* he);
+void hint_engine_start(struct hint_engine* he, const struct game_state* gs);
+void hint_engine_stop(struct hint_engine* he);
+void hint_observe(struct hint_engine* he, const struct game_state* gs, Key key);
+Key hint_next(struct hint_engine* he);
+
+// server.c, the protocol between `uni-void serve` and its clients.
+// both ends are built from this tree, so structs go over the socket as they are.
+
+// default socket of the server.
+#define SERVER_SOCKET "game_files/uni-void.sock"
+
+// longest player name a client can send, including the terminating 0.
+#define SERVER_NAME_MAX 32
+
+// largest custom board a server deals. hard games run the solver on the
+// server thread, which doesn't go beyond HINT_MAX_ORDER.
+#define SERVER_MAX_ORDER HINT_MAX_ORDER
+
+typedef enum {
+  req_new, // deal a new game of mode (order is only used by custom games)
+  req_key, // a key pressed by the player
+  req_name, // puts a won game on the leaderboard
+} Request;
+
+typedef enum {
+  reply_board, // count tiles follow, uint16 each in reading order
+  reply_leaderboard, // count struct server_record follow, best first
+  reply_error, // the request made no sense in the state of the session
+} Reply;
+
+typedef enum {
+  outcome_none, // no game dealt yet
+  outcome_playing,
+  outcome_won,
+  outcome_lost, // hard mode ran out of moves
+} Outcome;
+
+struct server_request {
+  uint32_t seq; // echoed by the reply, increasing
+  uint8_t type; // Request
+  int8_t key; // req_key
+  uint8_t mode; // req_new
+  uint8_t order; // req_new
+  char name[SERVER_NAME_MAX]; // req_name
+};
+
+// sent once for every batch of requests read, for the last of them.
+struct server_reply {
+  uint32_t seq;
+  uint8_t type; // Reply
+  uint8_t outcome; // Outcome
+  uint8_t order;
+  uint8_t mode;
+  uint16_t moves;
+  uint16_t curs_x;
+  uint16_t curs_y;
+  uint16_t count; // items that follow
+};
+
+struct server_record {
+  int64_t time;
+  uint16_t order;
+  uint16_t moves;
+  char player_name[SERVER_NAME_MAX];
+};
+
+// serves games on the unix socket at path until SIGINT or SIGTERM.
+int server_run(const char* path);
+
+// commands.c
+int run_command(int argc, char* argv[]);
@@ -11,10 +11,25 @@ The code base is split into separate files with some self-explanatory
 names.
   - main.c: contains main game logic
   - keymaps.c: contains a mapping of keys used in the game
+  - view.c : prompts, help window and leaderboard screen.
+  - frame_stats.c : timings of the game loop, see `uni-void --stats`.
+  - server.c : hosts the games of many players, see `uni-void serve`.
+  - client.c : plays a game hosted by a server, see `uni-void --connect`.
+  - libunivoid.h : interface of the game core, which is built from
+                   libunivoid.c into a static library without ncurses.
   - utils.c : some utility functions as well as some core logic functions
-  - leaderboard.c : functions for displaying and managing game leaderboard.
+  - kernels.c : moves and checks of the board, specialized per order.
+  - leaderboard.c : functions for managing game leaderboard.
   - save_and_load.c : defines functions for serializing and deserializing
                       current game state.
+  - solver.c : optimal solvers working on a flat copy of the board.
+  - reduction_solver.c : fast suboptimal solver for big boards.
+  - hint.c : background planner behind hints and auto-play.
+  - state_space.c : exhaustive analysis of small boards.
+  - generator.c : deals boards within the difficulty band of each mode.
+  - replay.c : compact replays of finished games and their verifier.
+  - timeline.c : boards of any past step of the game, for looking back.
+  - commands.c : headless commands (uni-void <command>) for tooling.
 
 Apart from the game logic, I used an arena-allocator for
 managing memory. Leaderboard has separate arena context defined
@@ -22,143 +37,13 @@ in leaderboard.c rather than the arena used for game.
 Arena definition can be found in lib/arena.c
 */
 
-// This header file contain all structs and macros used in game.
-#include "../lib/uni-void.c"
+// the game core, linked in from target/libunivoid.a
+#include "libunivoid.h"
 #include <ncurses.h>
 #include "keymaps.c"
-#include "leaderboard.c"
-#include "save_and_load.c"
-#include "utils.c"
-
-// updates moves based on count_ctrl
-void update_moves(struct game_state* gs) {
-  if (gs->count_ctrl == count_up) {
-    gs->moves++;
-  } else if (gs->count_ctrl == count_down){
-    gs->moves--;
-  }
-}
-
-// The below function checks solvability of our puzzle.
-// In an even-order puzzle, solvability depends not only on
-// the number of inversions but also on the row position of
-// the empty tile
-// This chat-gpt code. It works as expected.
-bool is_solvable(int* list, int order) {
-    int inversions = 0;
-    int size = order * order;
-    int blank_row = 0; // Row index of blank tile (zero)
-
-    for (int i = 0; i < size; i++) {
-        if (list[i] == 0) {
-            blank_row = i / order;  // Get row position of the blank (zero)
-            continue;
-        }
-        for (int j = i + 1; j < size; j++) {
-            if (list[j] && list[i] > list[j]) {
-                inversions++;
-            }
-        }
-    }
-
-    if (order % 2 != 0) {
-        return (inversions % 2 == 0);
-    }
-    return ((inversions + blank_row) % 2 == 1);
-}
-
-// This function populate our game matrix with a solvable combination
-// of natural numbers sorted in random order.
-void populate_mat(struct game_state* gs) {
-  int order = gs->order, rand_arr[order * order], pos = 0;
-  do {
-    // below creates an array of whole numbers upto given size limit
-    // and arrange them randomly. Defined in utils.c
-    make_radomized_array(rand_arr, order * order);
-  } while (!is_solvable(rand_arr, order));
-
-  for (int i = 0; i < order; i++) {
-    for (int j = 0; j < order; j++) {
-      if (rand_arr[pos] == 0) { // 0 is our void-tile.
-        gs->curs_x = i; // saves position of zero to start cursor from there.
-        gs->curs_y = j;
-      }
-      gs->mat[i][j] = rand_arr[pos];
-      pos++;
-    }
-  }
-}
-
-// prints the matrix using ncurses.
-// return true if all elements are sorted. ie if the game is completd.
-bool update_matrix_view(const struct game_state* gs) {
-  int count = 0, in_place = 0, n_elements = gs->order * gs->order;
-  erase();
-  
-  for (int i = 0; i < gs->order; i++) {
-    move(CENTER_Y(gs->order) + i, CENTER_X(gs->order * 4));
-    for (int j = 0; j < gs->order; j++) {
-      if (i == gs->curs_x && j == gs->curs_y) {
-        printw("    "); // void-tile in place of 0
-      } else {
-        if (count == gs->mat[i][j] - 1) {
-          in_place++;
-          attron(A_BOLD); // highlighting numbers that are in correct position
-          printw("%3d ", gs->mat[i][j]);
-          attroff(A_BOLD);
-        } else {
-          printw("%3d ", gs->mat[i][j]);
-        }
-        count++;
-      }
-    }
-    printw("\n");
-  }
-  return (in_place == n_elements - 1); // checking if the matrix is sorted.
-}
-
-// this function updates position of our 0 (void-tile) based on key input.
-Counter mov_zero(struct game_state* gs, Key key) {
-  int x = gs->curs_x, y = gs->curs_y;
-  switch (key) {
-    case key_up :
-      if (x == 0) return count_stop; else x--; break;
-    case key_down :
-      if (x == gs->order - 1) return count_stop; else x++; break;
-    case key_right :
-      if (y == gs->order - 1) return count_stop; else y++; break;
-    case key_left :
-      if (y == 0) return count_stop; else y--; break;
-    default : return count_stop;
-  }
-
-  swap(&(gs->mat[x][y]), &(gs->mat[gs->curs_x][gs->curs_y]));
-  gs->curs_x = x;
-  gs->curs_y = y;
-  return gs->count_ctrl;
-}
-
-// displays the bottom status line.
-void update_status_line(struct status_line data) {
-  int current_x, current_y;
-  getyx(stdscr, current_x, current_y);
-
-  mvprintw(LINES - 1, 1, " moves: %2zu", data.moves);
-  if (COLS > 30)
-    mvprintw(LINES - 1, CENTER_X(strlen(data.msg) - 8), "%s", data.msg);
-
-  move(LINES - 1, COLS - 2);
-  switch(data.key) {
-    case key_up: printw("U"); break;
-    case key_down: printw("D"); break;
-    case key_left: printw("L"); break;
-    case key_right: printw("R"); break;
-    default: break;
-  }
-  mvchgat(LINES - 1, 0, -1, A_REVERSE, 1, NULL);
-  
-  move(current_x, current_y);
-}
+#include "view.c"
+#include "frame_stats.c"
+#include "client.c"
 
 // driver function for menu.
 void show_menu(Key key, uint16_t *highlight) {
@@ -234,11 +119,53 @@ uint16_t choose_mode(struct status_line status) {
   exit(0);
 }
 
+// milliseconds left until the next frame may be drawn.
+int frame_wait(double last_frame) {
+  int wait = FRAME_INTERVAL_MS - (monotonic_seconds() - last_frame) * 1000;
+  return (wait > 0) ? wait : 0;
+}
+
+// step of the game to show after a timeline key, -1 for the game itself.
+// viewing is the step shown so far, length the steps made.
+int64_t scrub(Key key, int64_t viewing, uint32_t length) {
+  if (viewing < 0) viewing = length;
+  switch (key) {
+    case key_step_back : if (viewing > 0) viewing--; break;
+    case key_step_forward : viewing++; break;
+    default : {
+      char query[64];
+      snprintf(query, sizeof(query), "Jump to step (0 to %u): ", length);
+      char* step = input_str(query);
+      viewing = (*step >= '0' && *step <= '9') ? atol(step) : -1;
+      free(step);
+    }
+  }
+  return (viewing >= length) ? -1 : viewing;
+}
+
 int main(int argc, char* argv[]) {
+  struct frame_stats stats = { 0 }; // timings of every frame, off unless asked for
+  const char* server = NULL; // socket of the server hosting the game, if any
+  if (argc > 1 && strcmp(argv[1], "--stats") == 0) {
+    stats.visible = stats.dump = true;
+  } else if (argc > 1 && strcmp(argv[1], "--connect") == 0) {
+    server = (argc > 2) ? argv[2] : SERVER_SOCKET;
+  } else if (argc > 1) {
+    return run_command(argc - 1, argv + 1);
+  }
+
   srand(time(NULL));
-  Arena *arena = err_expect(arena_err, arena_init(128));
+  Arena *arena = arena_init(sizeof(int) * CUSTOM_MAX_ORDER * CUSTOM_MAX_ORDER); // fits the matrix of the largest board
+  struct hint_engine* hints = hint_engine_new();
+  if (arena == NULL || hints == NULL) {
+    fprintf(stderr, "uni-void: out of memory\n");
+    return 1;
+  }
 
   struct game_state gs;
+  struct replay replay = { 0 }; // every move made, for the leaderboard
+  struct timeline timeline = { 0 }; // checkpoints of the replay, for looking back
+  uint32_t seed = rand(); // the board is dealt from this
 
   initscr(); // initilize ncurses 
   noecho(); // Disables automatic echoing of typed characters
@@ -251,40 +178,76 @@ int main(int argc, char* argv[]) {
   Mode mode = choose_mode(status_line); // loads menu
   int order = mode + MODE_OFFSET; // here MODE_OFFSET is used to calculate order
 
+  if (server != NULL && mode != mode_exit) { // the game is played on the server, see client.c
+    if (mode == mode_load) {
+      status_line.msg = "games on a server aren't saved! press 'q' to quit";
+      goto wait_and_exit;
+    }
+    if (mode == mode_custom) {
+      char query[64];
+      snprintf(query, sizeof(query), "Input an order from 2 to %d: ", SERVER_MAX_ORDER);
+      char* answer = input_str(query);
+      order = atoi(answer);
+      free(answer);
+      if (order > SERVER_MAX_ORDER || order < 2) {
+        status_line.msg = "invalid order! press 'q' to quit";
+        goto wait_and_exit;
+      }
+    }
+    play_remote(server, mode, order, &status_line);
+    goto wait_and_exit;
+  }
+
   switch (mode) {
     case mode_load : // laod previously saved game.
-      gs = load_game_state(arena);
-      break;
-    case mode_hard : // hord mode has limited moves
-      gs = game_state_init(arena, order); 
-      populate_mat(&gs);
-      gs.moves = HARD_MODE_MOVE_LIMIT; // move limit is defined in univoid.h
-      gs.count_ctrl = count_down;
+      gs = load_game_state(arena, &replay);
+      if (gs.order == 0) {
+        status_line.msg = "couldn't load the saved game! press 'q' to quit";
+        goto wait_and_exit;
+      }
+      // the save doesn't keep the mode, its replay does. older saves keep
+      // the mode guessed from the order.
+      if (replay.order == gs.order && replay.mode >= mode_easy && replay.mode <= mode_custom) gs.mode = replay.mode;
       break;
+    case mode_hard : // hord mode has limited moves, see deal_game()
     case mode_easy :
     case mode_normal :
       gs = game_state_init(arena, order);
-      populate_mat(&gs);
-      gs.count_ctrl = count_up;
+      deal_game(&gs, mode, seed); // defined in generator.c
+      replay = replay_init(seed, mode, order);
       break;
-    case mode_custom : // user can specify order of square matrix.
-      order = atoi(input_str("Input an order from 2 to 16: "));
-      if (order > 16 || order < 2) {
+    case mode_custom : { // user can specify order of square matrix.
+      char query[64];
+      snprintf(query, sizeof(query), "Input an order from 2 to %d: ", CUSTOM_MAX_ORDER);
+      char* answer = input_str(query);
+      order = atoi(answer);
+      free(answer);
+      if (order > CUSTOM_MAX_ORDER || order < 2) {
         status_line.msg = "invalid order! press 'q' to quit";
         goto wait_and_exit;
       }
       gs = game_state_init(arena, order);
-      populate_mat(&gs);
-      gs.count_ctrl = count_up;
+      deal_game(&gs, mode, seed);
+      replay = replay_init(seed, mode, order);
       break;
+    }
     case mode_exit : goto exit;
   }
 
   bool completed = false, undoing; // flags to indicate game completion and undo-redo operation
+  Key action; // key as pressed, before undo or redo turn it into a move
+  bool autoplay = false, hint_wanted = false; // auto-play is on, a hint is being waited for
   Key key = key_invalid; // store keyboard input keys
+  int count = 0; // typed in front of a move, slides that many tiles
   Counter counter; // to indicate wheather or not to update move count.
   // when void-tile is in any edge, we don't want to count
   // moves that tries to go off that edge.
+  bool dirty = false; // something changed since the last frame
+  int64_t viewing = -1; // step of the game on screen, -1 for the game itself
+  struct game_state past = game_state_init(arena, gs.order); // board of that step
+  char step_msg[64];
+  timeline_init(&timeline, &replay, &gs);
+  double last_frame = monotonic_seconds();
 
   status_line.msg = "sort the matrix!";
   status_line.moves = gs.moves;
@@ -293,62 +256,174 @@ int main(int argc, char* argv[]) {
   update_status_line(status_line);
 
   while (key != key_exit) {
-    undoing = false;
-    key = decode_key(getch());
-
-    switch (key) {
-      case key_invalid : case key_exit : continue;
-      case key_undo : // pop from undo stack, push inverse of that key to redo stack
-        if ((key = pop_key(gs.undo_stack, &gs.utop)) == key_invalid) continue;
-        push_key(gs.redo_stack, &gs.rtop, key * -1);
-        undoing = true; // indicator to stop counting moves.
-        break;
-      case key_redo: // pop redo-stack, push inverse of that key to undo stack
-        if ((key = pop_key(gs.redo_stack, &gs.rtop)) == key_invalid) continue;
-        push_key(gs.undo_stack, &gs.utop, key * -1);
-        undoing = true;
-        break;
-      case key_usage : display_usage();
-        break;
-      case key_force_quit : goto exit;
-      default : break;
+    // getch() only times out while auto-playing or waiting for a hint.
+    timeout((autoplay || hint_wanted) ? AUTOPLAY_DELAY_MS : -1);
+    int ch = getch();
+    uint64_t batch_start = stats_on(&stats) ? stats_clock() : 0;
+    stats_timed(&stats, stage_decode, key = decode_counted_key(ch, &count));
+
+    if (ch == ERR) {
+      key = hint_next(hints);
+      if (hint_wanted && key != key_invalid) {
+        hint_wanted = false;
+        status_line.msg = hint_message(key);
+        dirty = true;
+      }
+      if (!autoplay || viewing >= 0) key = key_invalid;
     }
 
-    // updating matrix view
-    counter = mov_zero(&gs, key);
-    completed = update_matrix_view(&gs);
-
-    if (counter != count_stop && !undoing ) {
-      push_key(gs.undo_stack, &gs.utop, key * -1); // pushing inverse key to undo stack
-      update_moves(&gs);
-      status_line.moves = gs.moves;
-      status_line.key = key;
-      if (gs.mode == mode_hard && gs.moves == 0) { // hard_mode ends when counter reach 0
-        status_line.msg = "Game over! press 'q' to exit";
+    // every key already waiting is applied before anything is drawn, so a
+    // held down arrow or a pasted string of moves costs one frame per batch
+    // instead of one per key.
+    int batched = 0;
+    while (key != key_exit) {
+      undoing = false;
+      // any other key while looking back only returns to the game.
+      if (viewing >= 0 && key != key_invalid && key != key_step_back && key != key_step_forward &&
+          key != key_jump && key != key_exit && key != key_force_quit && key != key_resize) {
+        viewing = -1;
+        key = key_invalid;
+        status_line.msg = autoplay ? "auto-play on" : "sort the matrix!";
+        dirty = true;
+      }
+      action = key;
+      switch (key) {
+        case key_hint :
+          if (gs.order > HINT_MAX_ORDER) {
+            status_line.msg = "no hints for boards this big";
+            dirty = true;
+            break;
+          }
+          hint_engine_start(hints, &gs);
+          hint_wanted = (hint_next(hints) == key_invalid);
+          status_line.msg = hint_message(hint_next(hints));
+          dirty = true;
+          break;
+        case key_autoplay :
+          if (gs.order > HINT_MAX_ORDER) {
+            status_line.msg = "no hints for boards this big";
+            dirty = true;
+            break;
+          }
+          hint_engine_start(hints, &gs);
+          autoplay = !autoplay;
+          status_line.msg = autoplay ? "auto-play on" : "auto-play off";
+          dirty = true;
+          break;
+        case key_undo : // pop from undo stack, push inverse of that key to redo stack
+          if ((key = pop_key(gs.undo_stack, &gs.utop)) == key_invalid) break;
+          push_key(gs.redo_stack, &gs.rtop, key * -1);
+          undoing = true; // indicator to stop counting moves.
+          break;
+        case key_redo: // pop redo-stack, push inverse of that key to undo stack
+          if ((key = pop_key(gs.redo_stack, &gs.rtop)) == key_invalid) break;
+          push_key(gs.undo_stack, &gs.utop, key * -1);
+          undoing = true;
+          break;
+        case key_usage :
+          timeout(-1);
+          display_usage();
+          dirty = true;
+          break;
+        case key_stats :
+          stats.visible = !stats.visible;
+          dirty = true;
+          break;
+        case key_step_back : case key_step_forward : case key_jump :
+          dirty = true;
+          if (timeline.order == 0) { // games saved before replays
+            status_line.msg = "no timeline for this game";
+            break;
+          }
+          if (key == key_jump) timeout(-1);
+          if ((viewing = scrub(key, viewing, replay.length)) < 0) {
+            status_line.msg = autoplay ? "auto-play on" : "sort the matrix!";
+            break;
+          }
+          timeline_seek(&timeline, &replay, viewing, &past);
+          snprintf(step_msg, sizeof(step_msg), "step %ld of %u, any key to return", viewing, replay.length);
+          status_line.msg = step_msg;
+          break;
+        case key_resize : dirty = true; break;
+        case key_force_quit : goto exit;
+        default : break;
+      }
+
+      // only moves of the void-tile get past this. anything else is
+      // turned away by mov_zero() as a move off the edge. a slide goes as
+      // far as it can, undo and redo put back exactly what was done.
+      if (!undoing) key = slide_clamp(&gs, key);
+      stats_timed(&stats, stage_move, counter = mov_zero(&gs, key));
+      if (counter == count_stop && undoing) unpop_key(&gs, action, key);
+      if (counter != count_stop) {
+        replay_record(&replay, key, action);
+        timeline_record(&timeline, &replay, &gs);
+        hint_observe(hints, &gs, key);
+        status_line.msg = autoplay ? "auto-play on" : "sort the matrix!";
+        dirty = true;
+      }
+
+      if (counter != count_stop && !undoing ) {
+        push_key(gs.undo_stack, &gs.utop, key * -1); // pushing inverse key to undo stack
+        update_moves(&gs, key);
+        status_line.moves = gs.moves;
+        status_line.key = key;
+        if (gs.mode == mode_hard && gs.moves == 0) { // hard_mode ends when counter reach 0
+          update_matrix_view(&gs);
+          status_line.msg = "Game over! press 'q' to exit";
+          goto wait_and_exit;
+        }
+      }
+
+      if (counter != count_stop && (completed = is_sorted(&gs))) {
+        time_t finished = time(NULL); // names the replay of this leaderboard row
+        if (replay.order != 0) replay_save(&replay, finished); // games saved before replays have none
+        timeout(-1);
+        display_leaderboards(&gs, input_str("You won, enter your nickname: "), finished);
+        status_line.msg = "Press 'q' to quit...";
         goto wait_and_exit;
       }
+
+      // the batch goes on while keys are pending, or until the next frame
+      // is due if the last one was drawn only a moment ago.
+      if (++batched == INPUT_BATCH) break;
+      timeout(frame_wait(last_frame));
+      if ((ch = getch()) == ERR) break;
+      stats_timed(&stats, stage_decode, key = decode_counted_key(ch, &count));
     }
 
-    if (completed) {
-      display_leaderboards(&gs, input_str("You won, enter your nickname: "));
-      status_line.msg = "Press 'q' to quit...";
-      goto wait_and_exit;
+    if (dirty) {
+      stats_timed(&stats, stage_matrix, update_matrix_view((viewing >= 0) ? &past : &gs));
+      stats_timed(&stats, stage_status, update_status_line(status_line));
+      if (stats.visible) stats_draw(&stats);
+      stats_timed(&stats, stage_refresh, refresh());
+      if (stats_on(&stats) && batch_start != 0) {
+        stats_add(&stats, stage_frame, stats_clock() - batch_start);
+        stats_frame_end(&stats, batched);
+      }
+      last_frame = monotonic_seconds();
+      dirty = false;
     }
-    update_status_line(status_line);
-    refresh();
   } 
 
   if (!completed) {
-    save_game_state(&gs);
+    save_game_state(&gs, &replay);
     status_line.msg = "Game saved. Press 'q' to quit";
   }
 
   wait_and_exit: // label to printing some message onto status line before exiting.
+  timeout(-1);
+  hint_engine_stop(hints);
   update_status_line(status_line);
   refresh();
   while(getch() != 'q');
 
   exit: // directly end the program
+    if (stats.dump && !stats_save(&stats)) perror("Failed to write frame stats");
+    stats_free(&stats);
+    hint_engine_free(hints);
+    replay_free(&replay);
+    timeline_free(&timeline);
     endwin();
     arena_free(arena);
     return 0;
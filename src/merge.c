@@ -0,0 +1,247 @@
+/*
+Merging the leaderboards of many hosts: `uni-void merge <output> <files...>`.
+
+Every host has a leaderboard file of its own, written by save_record().
+The rows of all of them are merged into one file, best first on every
+order, with a k-way merge:
+
+  - every input is read with stream_leaderboard() into a chunk of
+    MERGE_CHUNK records, which is sorted and becomes a run. a run that
+    fits in MERGE_BUFFER records stays in memory, longer ones are spilled
+    to a temporary file and read back MERGE_BUFFER records at a time. a
+    file written by the game is a single run that never touches the disk.
+  - the heads of all runs sit in a binary min-heap, ordered by
+    (order, moves, time, name). rows keep the moves used in every mode
+    (see moves_used()), so fewer moves always come first.
+  - identical rows (the same game copied to two hosts) come out of the
+    heap one after another and only the first one is written.
+  - only the best `keep` rows of every order are written.
+  - once there are MERGE_FAN_IN runs, they are merged the same way into a
+    single run, which holds no more than `keep` rows of every order. so
+    there are never more than MERGE_FAN_IN runs (and temporary files)
+    however many inputs and rows there are.
+
+Memory is one chunk while reading and a MERGE_BUFFER sized buffer per run
+while merging, at most MERGE_FAN_IN of them. The output is written next
+to its final path and renamed over it, so it can be one of the inputs.
+*/
+
+#pragma once
+
+#include <limits.h>
+#include "libunivoid.h"
+#include "leaderboard.c"
+
+#define MERGE_CHUNK 65536 // records sorted in memory at once
+#define MERGE_BUFFER 256 // records of a run held in memory while merging
+#define MERGE_FAN_IN 64 // runs merged at once
+
+struct merge_record {
+  uint16_t order;
+  uint16_t moves;
+  int64_t time;
+  char name[LEADERBOARD_NAME_MAX];
+};
+
+// a sorted run of records, read from the front.
+struct merge_run {
+  struct merge_record* buf;
+  uint32_t length, next;
+  FILE* spill; // rest of the run, NULL if it all fit in buf
+};
+
+struct merge {
+  struct merge_record* chunk;
+  uint32_t chunk_length;
+  struct merge_run runs[MERGE_FAN_IN];
+  uint32_t n_runs;
+  uint32_t keep; // rows kept for every order
+  struct merge_stats* stats;
+  bool failed;
+};
+
+static int merge_compare(const struct merge_record* a, const struct merge_record* b) {
+  if (a->order != b->order) return (a->order > b->order) - (a->order < b->order);
+  if (a->moves != b->moves) return (a->moves > b->moves) ? 1 : -1;
+  if (a->time != b->time) return (a->time > b->time) - (a->time < b->time);
+  return strcmp(a->name, b->name);
+}
+
+static int compare_merge_records(const void* a, const void* b) {
+  return merge_compare(a, b);
+}
+
+// reads the next records of a spilled run into its buffer.
+static void merge_run_refill(struct merge_run* run) {
+  run->next = 0;
+  run->length = (run->spill) ? fread(run->buf, sizeof(struct merge_record), MERGE_BUFFER, run->spill) : 0;
+}
+
+static struct merge_record* merge_run_head(const struct merge_run* run) {
+  return (run->next < run->length) ? &run->buf[run->next] : NULL;
+}
+
+static void merge_run_free(struct merge_run* run) {
+  free(run->buf);
+  if (run->spill) fclose(run->spill);
+}
+
+static bool merge_collapse(struct merge* m);
+
+// sorts the chunk and turns it into a run.
+static bool merge_flush_chunk(struct merge* m) {
+  if (m->chunk_length == 0) return true;
+  qsort(m->chunk, m->chunk_length, sizeof(struct merge_record), compare_merge_records);
+  if (m->n_runs == MERGE_FAN_IN && !merge_collapse(m)) return false;
+  struct merge_run run = { .spill = NULL };
+  uint32_t length = (m->chunk_length < MERGE_BUFFER) ? m->chunk_length : MERGE_BUFFER;
+  if ((run.buf = malloc(sizeof(struct merge_record) * length)) == NULL) return false;
+  if (m->chunk_length <= MERGE_BUFFER) {
+    memcpy(run.buf, m->chunk, sizeof(struct merge_record) * length);
+    run.length = length;
+  } else {
+    if ((run.spill = tmpfile()) == NULL ||
+        fwrite(m->chunk, sizeof(struct merge_record), m->chunk_length, run.spill) != m->chunk_length) {
+      if (run.spill) fclose(run.spill);
+      free(run.buf);
+      return false;
+    }
+    rewind(run.spill);
+    merge_run_refill(&run);
+  }
+  m->runs[m->n_runs++] = run;
+  m->stats->runs++;
+  m->chunk_length = 0;
+  return true;
+}
+
+static void merge_visit(const struct leaderboard_record* record, void* ctx) {
+  struct merge* m = ctx;
+  if (m->failed) return;
+  struct merge_record* r = &m->chunk[m->chunk_length++];
+  *r = (struct merge_record) { .order = record->order, .moves = record->moves, .time = record->time };
+  strcpy(r->name, record->player_name);
+  if (m->chunk_length == MERGE_CHUNK && !merge_flush_chunk(m)) m->failed = true;
+}
+
+// restores the heap below i. heap holds indices of runs that aren't drained.
+static void merge_sift_down(const struct merge* m, uint32_t* heap, uint32_t n, uint32_t i) {
+  for (;;) {
+    uint32_t least = i, l = 2 * i + 1, r = 2 * i + 2;
+    if (l < n && merge_compare(merge_run_head(&m->runs[heap[l]]), merge_run_head(&m->runs[heap[least]])) < 0) least = l;
+    if (r < n && merge_compare(merge_run_head(&m->runs[heap[r]]), merge_run_head(&m->runs[heap[least]])) < 0) least = r;
+    if (least == i) return;
+    uint32_t tmp = heap[i];
+    heap[i] = heap[least];
+    heap[least] = tmp;
+    i = least;
+  }
+}
+
+// merges the runs into out, keeping the best m->keep rows of every order.
+// out gets the csv of the leaderboard, or the records as they are when
+// !csv. rows written to a run aren't counted as written yet.
+static bool merge_write(struct merge* m, FILE* out, bool csv) {
+  struct merge_stats* stats = m->stats;
+  uint32_t* heap = malloc(sizeof(uint32_t) * (m->n_runs + 1));
+  if (heap == NULL) return false;
+  uint32_t n = 0, kept = 0;
+  for (uint32_t i = 0; i < m->n_runs; i++) {
+    if (merge_run_head(&m->runs[i])) heap[n++] = i;
+  }
+  for (uint32_t i = n / 2; i-- > 0;) merge_sift_down(m, heap, n, i);
+
+  struct merge_record last;
+  bool first = true;
+  if (csv) fprintf(out, "\"Order\",\"Moves\",\"Player\",\"Time\"\n");
+  while (n > 0) {
+    struct merge_run* run = &m->runs[heap[0]];
+    struct merge_record* r = merge_run_head(run);
+    if (first || r->order != last.order) kept = 0;
+    if (!first && merge_compare(r, &last) == 0) {
+      stats->duplicates++;
+    } else if (kept == m->keep) {
+      stats->dropped++;
+    } else if (csv) {
+      fprintf(out, "%d,%d,\"%s\",%ld\n", r->order, r->moves, r->name, r->time);
+      stats->written++;
+      kept++;
+    } else {
+      fwrite(r, sizeof(struct merge_record), 1, out);
+      kept++;
+    }
+    last = *r;
+    first = false;
+
+    if (++run->next == run->length) merge_run_refill(run);
+    if (merge_run_head(run) == NULL) heap[0] = heap[--n];
+    merge_sift_down(m, heap, n, 0);
+  }
+  free(heap);
+  return !ferror(out);
+}
+
+// merges every run into a single one, spilled to a temporary file.
+static bool merge_collapse(struct merge* m) {
+  struct merge_run run = { .buf = malloc(sizeof(struct merge_record) * MERGE_BUFFER), .spill = tmpfile() };
+  if (run.buf == NULL || run.spill == NULL || !merge_write(m, run.spill, false) || fflush(run.spill) != 0) {
+    merge_run_free(&run);
+    return false;
+  }
+  for (uint32_t i = 0; i < m->n_runs; i++) merge_run_free(&m->runs[i]);
+  rewind(run.spill);
+  merge_run_refill(&run);
+  m->runs[0] = run;
+  m->n_runs = 1;
+  return true;
+}
+
+// merges the leaderboard files inputs into one at output, with the best
+// keep rows of every order. counts go to stats. returns false if an input
+// couldn't be read or the output couldn't be written, output is left as
+// it was then.
+bool merge_leaderboards(const char* output, char* const inputs[], int n_inputs, uint32_t keep, struct merge_stats* stats) {
+  struct merge m = { .chunk = malloc(sizeof(struct merge_record) * MERGE_CHUNK), .keep = keep, .stats = stats };
+  *stats = (struct merge_stats) { 0 };
+  bool ok = m.chunk != NULL;
+  if (!ok) fprintf(stderr, "merge: out of memory\n");
+
+  for (int i = 0; ok && i < n_inputs; i++) {
+    FILE* fp = fopen(inputs[i], "r");
+    if (fp == NULL) {
+      fprintf(stderr, "merge: couldn't read %s\n", inputs[i]);
+      ok = false;
+      break;
+    }
+    uint64_t skipped;
+    stats->records += stream_leaderboard(fp, merge_visit, &m, &skipped);
+    stats->skipped += skipped;
+    if (ferror(fp)) {
+      fprintf(stderr, "merge: couldn't read %s\n", inputs[i]);
+      ok = false;
+    }
+    fclose(fp);
+    // every file ends its own run, so a game's file is never spilled.
+    if (ok && (m.failed || !merge_flush_chunk(&m))) {
+      fprintf(stderr, "merge: out of memory or temporary files\n");
+      ok = false;
+    }
+  }
+  free(m.chunk);
+
+  if (ok) {
+    char tmp_path[PATH_MAX];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", output);
+    FILE* out = fopen(tmp_path, "w");
+    ok = out != NULL && merge_write(&m, out, true);
+    if (out != NULL && fclose(out) != 0) ok = false;
+    if (ok && rename(tmp_path, output) != 0) ok = false;
+    if (!ok) {
+      fprintf(stderr, "merge: couldn't write %s\n", output);
+      remove(tmp_path);
+    }
+  }
+
+  for (uint32_t i = 0; i < m.n_runs; i++) merge_run_free(&m.runs[i]);
+  return ok;
+}
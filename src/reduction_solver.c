@@ -0,0 +1,379 @@
+/*
+A fast, suboptimal solver for boards that are too big for ida_star().
+
+The board is reduced one line at a time the way people solve these
+puzzles by hand: the top row is sorted and locked, then the left column,
+then the top row of what remains and so on, until only a 3x3 board is
+left, which is solved optimally.
+
+Tiles are moved into place by a breadth-first search over (tile, void)
+positions that never touches locked cells. The last two tiles of a line
+can't be placed one after another without breaking the first one, so
+both of them (and the void) are first herded into a 4x4 box at the end
+of the line, and the box is then solved as a tiny puzzle of its own.
+
+The raw solution is then refined: moves that undo the previous move are
+cancelled, and short windows of the solution are re-solved optimally with
+ida_search() and replaced when a shorter path exists.
+*/
+
+#pragma once
+
+#include "../lib/uni-void.c"
+#include "solver.c"
+
+// length of the windows re-solved by the refinement pass.
+#define REFINE_WINDOW 16
+// nodes a refinement search may expand before the window is left as is.
+#define REFINE_NODE_LIMIT 4000
+
+// cells of the box used to place the last two tiles of a line.
+#define BOX_MAX 16
+#define BOX_STATES (BOX_MAX * BOX_MAX * BOX_MAX)
+
+// growable list of moves.
+struct move_list {
+  Key* keys;
+  uint32_t length;
+  uint32_t capacity;
+};
+
+void move_list_push(struct move_list* list, Key key) {
+  if (list->length == list->capacity) {
+    list->capacity = (list->capacity == 0) ? 64 : list->capacity * 2;
+    list->keys = realloc(list->keys, sizeof(Key) * list->capacity);
+  }
+  list->keys[list->length++] = key;
+}
+
+void move_list_free(struct move_list* list) {
+  free(list->keys);
+  *list = (struct move_list) { NULL, 0, 0 };
+}
+
+struct reducer {
+  struct puzzle w; // board being solved
+  bool locked[SOLVER_MAX_CELLS]; // cells the void must not enter
+  struct move_list* out;
+  atomic_bool* cancel;
+  int cells;
+  // scratch space of the (tile, void) search, one slot per state.
+  uint32_t* seen;
+  uint32_t stamp;
+  int32_t* parent;
+  int8_t* via;
+  int32_t* queue;
+};
+
+static void reducer_move(struct reducer* r, Key key) {
+  puzzle_move(&r->w, key);
+  move_list_push(r->out, key);
+}
+
+static int tile_position(const struct puzzle* p, int tile) {
+  int size = p->order * p->order;
+  for (int i = 0; i < size; i++) {
+    if (p->tiles[i] == tile) return i;
+  }
+  return -1;
+}
+
+// replays the moves of the search tree from state back to the root.
+static void reducer_replay(struct reducer* r, int32_t state, int32_t root) {
+  int length = 0;
+  for (int32_t s = state; s != root; s = r->parent[s]) length++;
+  Key* keys = malloc(sizeof(Key) * length);
+  for (int32_t s = state, i = length - 1; s != root; s = r->parent[s], i--) keys[i] = r->via[s];
+  for (int i = 0; i < length; i++) reducer_move(r, keys[i]);
+  free(keys);
+}
+
+// moves the tile at cell `from` onto any cell of goal, searching only the
+// cells inside the rectangle [top, bottom] x [left, right].
+static bool move_tile_within(struct reducer* r, int from, const bool* goal, int top, int bottom, int left, int right) {
+  int order = r->w.order, cells = r->cells, head = 0, tail = 0;
+  int32_t root = from * cells + r->w.zero;
+
+  r->stamp++;
+  r->seen[root] = r->stamp;
+  r->queue[tail++] = root;
+  while (head < tail) {
+    int32_t state = r->queue[head++];
+    int tile = state / cells, zero = state % cells;
+    if (goal[tile]) {
+      reducer_replay(r, state, root);
+      return true;
+    }
+    for (int i = 0; i < 4; i++) {
+      int next = puzzle_move_target(order, zero, solver_moves[i]);
+      if (next < 0 || r->locked[next]) continue;
+      if (next / order < top || next / order > bottom || next % order < left || next % order > right) continue;
+      int32_t child = ((next == tile) ? zero : tile) * cells + next;
+      if (r->seen[child] == r->stamp) continue;
+      r->seen[child] = r->stamp;
+      r->parent[child] = state;
+      r->via[child] = solver_moves[i];
+      r->queue[tail++] = child;
+    }
+  }
+  return false;
+}
+
+// moves tile onto any cell of goal without disturbing locked cells.
+// the search first stays close to the tile, the void and the goal, and
+// only falls back to the whole board when that fails.
+static bool move_tile(struct reducer* r, int tile, const bool* goal) {
+  int order = r->w.order, from = tile_position(&r->w, tile);
+  int top = order, bottom = 0, left = order, right = 0;
+
+  for (int cell = 0; cell < r->cells; cell++) {
+    if (!goal[cell] && cell != from && cell != r->w.zero) continue;
+    if (cell / order < top) top = cell / order;
+    if (cell / order > bottom) bottom = cell / order;
+    if (cell % order < left) left = cell % order;
+    if (cell % order > right) right = cell % order;
+  }
+  top = (top > 0) ? top - 1 : 0;
+  left = (left > 0) ? left - 1 : 0;
+  bottom = (bottom < order - 1) ? bottom + 1 : order - 1;
+  right = (right < order - 1) ? right + 1 : order - 1;
+
+  if (move_tile_within(r, from, goal, top, bottom, left, right)) return true;
+  return move_tile_within(r, from, goal, 0, order - 1, 0, order - 1);
+}
+
+// moves the void onto any unlocked cell of goal.
+static bool move_void(struct reducer* r, const bool* goal) {
+  int order = r->w.order, head = 0, tail = 0, root = r->w.zero;
+
+  r->stamp++;
+  r->seen[root] = r->stamp;
+  r->queue[tail++] = root;
+  while (head < tail) {
+    int cell = r->queue[head++];
+    if (goal[cell] && !r->locked[cell]) {
+      reducer_replay(r, cell, root);
+      return true;
+    }
+    for (int i = 0; i < 4; i++) {
+      int next = puzzle_move_target(order, cell, solver_moves[i]);
+      if (next < 0 || r->locked[next] || r->seen[next] == r->stamp) continue;
+      r->seen[next] = r->stamp;
+      r->parent[next] = cell;
+      r->via[next] = solver_moves[i];
+      r->queue[tail++] = next;
+    }
+  }
+  return false;
+}
+
+// x, y and the void are inside box. moves x onto cell a and y onto cell b
+// using the box cells only. every other tile in the box is interchangeable,
+// so a breadth-first search over the three positions is enough.
+static bool solve_box(struct reducer* r, const int* box, int box_len, int x, int y, int a, int b) {
+  int local[SOLVER_MAX_CELLS], order = r->w.order, head = 0, tail = 0;
+  int16_t parent[BOX_STATES];
+  int8_t via[BOX_STATES];
+  int16_t queue[BOX_STATES];
+
+  for (int i = 0; i < r->cells; i++) local[i] = -1;
+  for (int i = 0; i < box_len; i++) local[box[i]] = i;
+  for (int i = 0; i < BOX_STATES; i++) parent[i] = -1;
+
+  int root = (local[tile_position(&r->w, x)] * BOX_MAX + local[tile_position(&r->w, y)]) * BOX_MAX + local[r->w.zero];
+  parent[root] = root;
+  queue[tail++] = root;
+  while (head < tail) {
+    int state = queue[head++];
+    int px = state / (BOX_MAX * BOX_MAX), py = state / BOX_MAX % BOX_MAX, pz = state % BOX_MAX;
+    if (box[px] == a && box[py] == b) {
+      int keys[BOX_STATES], length = 0;
+      for (int s = state; s != root; s = parent[s]) keys[length++] = via[s];
+      while (length > 0) reducer_move(r, keys[--length]);
+      return true;
+    }
+    for (int i = 0; i < 4; i++) {
+      int next = puzzle_move_target(order, box[pz], solver_moves[i]);
+      if (next < 0 || local[next] < 0) continue;
+      int nz = local[next], nx = (nz == px) ? pz : px, ny = (nz == py) ? pz : py;
+      int child = (nx * BOX_MAX + ny) * BOX_MAX + nz;
+      if (parent[child] >= 0) continue;
+      parent[child] = state;
+      via[child] = solver_moves[i];
+      queue[tail++] = child;
+    }
+  }
+  return false;
+}
+
+// cell at position i along a line and j cells deep into the board. rows
+// are walked left to right, columns top to bottom.
+static inline int line_cell(int order, bool is_row, int k, int i, int j) {
+  return is_row ? (k + j) * order + i : i * order + (k + j);
+}
+
+// sorts and locks row k (or column k) of the board.
+static bool reduce_line(struct reducer* r, bool is_row, int k) {
+  int order = r->w.order, first = is_row ? k : k + 1;
+  bool goal[SOLVER_MAX_CELLS] = { false };
+
+  for (int i = first; i < order - 2; i++) {
+    int target = line_cell(order, is_row, k, i, 0);
+    goal[target] = true;
+    if (!move_tile(r, target + 1, goal)) return false;
+    goal[target] = false;
+    r->locked[target] = true;
+    if (r->cancel && atomic_load(r->cancel)) return false;
+  }
+
+  // last two tiles of the line. y is parked in the 3x3 corner at the end
+  // of the line, then x, and the void are brought into the 4x4 box around
+  // it. keeping y off the border of the box means x never gets trapped
+  // between y and the edge of the board on its way in.
+  int a = line_cell(order, is_row, k, order - 2, 0), b = line_cell(order, is_row, k, order - 1, 0);
+  int x = a + 1, y = b + 1, box[BOX_MAX], box_len = 0;
+  bool corner[SOLVER_MAX_CELLS] = { false };
+  if (r->w.tiles[a] != x || r->w.tiles[b] != y) {
+    for (int i = order - 4; i < order; i++) {
+      for (int j = 0; j < 4; j++) {
+        int cell = line_cell(order, is_row, k, i, j);
+        if (r->locked[cell]) continue;
+        goal[cell] = true;
+        corner[cell] = (i >= order - 3 && j < 3);
+        box[box_len++] = cell;
+      }
+    }
+    if (!move_tile(r, y, corner)) return false;
+    int py = tile_position(&r->w, y);
+    r->locked[py] = true;
+    if (!move_tile(r, x, goal)) return false;
+    int px = tile_position(&r->w, x);
+    r->locked[px] = true;
+    if (!move_void(r, goal)) return false;
+    r->locked[px] = r->locked[py] = false;
+    if (!solve_box(r, box, box_len, x, y, a, b)) return false;
+  }
+  r->locked[a] = r->locked[b] = true;
+  return true;
+}
+
+// solves the 3x3 board left in the bottom right corner optimally.
+static bool solve_corner(struct reducer* r) {
+  int order = r->w.order, base = order - 3;
+  struct puzzle corner = { .order = 3 };
+  Key path[SOLVER_MAX_DEPTH];
+
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      int tile = r->w.tiles[(base + i) * order + base + j];
+      if (tile == 0) {
+        corner.zero = i * 3 + j;
+        corner.tiles[i * 3 + j] = 0;
+      } else { // relabel tiles by their goal position inside the corner
+        int row = (tile - 1) / order - base, col = (tile - 1) % order - base;
+        corner.tiles[i * 3 + j] = row * 3 + col + 1;
+      }
+    }
+  }
+  struct solver_config cfg = { .heuristic = heur_linear_conflict, .cancel = r->cancel };
+  int length = ida_star(&corner, path, &cfg, NULL);
+  if (length == SOLVER_FAILED) return false;
+  for (int i = 0; i < length; i++) reducer_move(r, path[i]);
+  return true;
+}
+
+// drops every move that is immediately undone by the next one.
+static void cancel_reversals(struct move_list* list) {
+  uint32_t top = 0;
+  for (uint32_t i = 0; i < list->length; i++) {
+    if (top > 0 && list->keys[top - 1] == -list->keys[i]) top--;
+    else list->keys[top++] = list->keys[i];
+  }
+  list->length = top;
+}
+
+// re-solves consecutive windows of the solution optimally, starting at
+// offset, and splices in any shorter path that is found.
+static void refine_windows(const struct puzzle* start, struct move_list* list, uint32_t offset, atomic_bool* cancel) {
+  struct solver_config cfg = { .heuristic = heur_manhattan, .node_limit = REFINE_NODE_LIMIT, .cancel = cancel };
+  struct move_list refined = { 0 };
+  struct puzzle from = *start, to;
+  Key path[REFINE_WINDOW];
+  uint32_t i = 0;
+
+  for (; i < offset && i < list->length; i++) {
+    puzzle_move(&from, list->keys[i]);
+    move_list_push(&refined, list->keys[i]);
+  }
+  while (i < list->length) {
+    uint32_t window = (list->length - i < REFINE_WINDOW) ? list->length - i : REFINE_WINDOW;
+    to = from;
+    for (uint32_t j = 0; j < window; j++) puzzle_move(&to, list->keys[i + j]);
+
+    int length = (window > 2) ? ida_search(&from, &to, window - 1, path, &cfg, NULL) : SOLVER_FAILED;
+    if (length != SOLVER_FAILED) {
+      for (int j = 0; j < length; j++) move_list_push(&refined, path[j]);
+    } else {
+      for (uint32_t j = 0; j < window; j++) move_list_push(&refined, list->keys[i + j]);
+    }
+    from = to;
+    i += window;
+  }
+  move_list_free(list);
+  *list = refined;
+}
+
+// solves p without any optimality guarantee. moves are appended to out.
+// refine spends some extra time shortening the solution.
+// returns the number of moves or SOLVER_FAILED.
+int reduction_solve(const struct puzzle* p, struct move_list* out, bool refine, atomic_bool* cancel) {
+  struct move_list moves = { 0 };
+  struct reducer r = {
+    .w = *p,
+    .out = &moves,
+    .cancel = cancel,
+    .cells = p->order * p->order,
+  };
+  bool solved = true;
+
+  if (p->order <= 3) {
+    Key path[SOLVER_MAX_DEPTH];
+    struct solver_config cfg = { .heuristic = heur_linear_conflict, .cancel = cancel };
+    int length = ida_star(p, path, &cfg, NULL);
+    if (length == SOLVER_FAILED) return SOLVER_FAILED;
+    for (int i = 0; i < length; i++) move_list_push(out, path[i]);
+    return length;
+  }
+
+  size_t states = (size_t)r.cells * r.cells;
+  r.seen = calloc(states, sizeof(uint32_t));
+  r.parent = malloc(states * sizeof(int32_t));
+  r.via = malloc(states * sizeof(int8_t));
+  r.queue = malloc(states * sizeof(int32_t));
+
+  for (int k = 0; solved && k < p->order - 3; k++) {
+    solved = reduce_line(&r, true, k) && reduce_line(&r, false, k);
+  }
+  solved = solved && solve_corner(&r);
+
+  free(r.seen);
+  free(r.parent);
+  free(r.via);
+  free(r.queue);
+
+  if (!solved) {
+    move_list_free(&moves);
+    return SOLVER_FAILED;
+  }
+
+  cancel_reversals(&moves);
+  if (refine) {
+    refine_windows(p, &moves, 0, cancel);
+    refine_windows(p, &moves, REFINE_WINDOW / 2, cancel);
+    cancel_reversals(&moves);
+  }
+  int length = moves.length;
+  for (uint32_t i = 0; i < moves.length; i++) move_list_push(out, moves.keys[i]);
+  move_list_free(&moves);
+  return length;
+}
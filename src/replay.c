@@ -0,0 +1,258 @@
+/*
+Replays of finished games.
+
+Every game is dealt from a seed (see deal_game()), so a replay only has
+to keep that seed, the mode the board was dealt for and the moves made:
+
+  - moves : every move of the void-tile, 2 bits each. undo and redo move
+            the void-tile too, so they are recorded like any other move.
+  - marks : the few moves that were an undo or a redo, as
+            (index << 1 | is_redo), in ascending order. these don't count
+            as moves, so the verifier has to know about them.
+  - slides : the moves that were made together by one slide (see
+             slide_key()), as (index of the first, tiles) pairs in
+             ascending order. they are in moves one tile at a time, so
+             nothing but the verifier needs them, but a slide is a single
+             entry on the undo stack and is undone as one. an undo or redo
+             of a slide marks its first move.
+
+Replays are saved under REPLAY_DIR, named after the time the game was
+finished, which is the timestamp of its leaderboard row. The verifier
+deals the board again and feeds every move through mov_zero() with the
+same undo/redo stacks the game uses, so a replay only checks out if it
+is a game the real game loop would have accepted.
+
+layout of a replay file (all little endian):
+  magic, seed, finished : uint32, uint32, int64
+  mode, order : uint8, uint8
+  length, n_marks, n_slides : uint32, uint32, uint32
+  marks : uint32[n_marks]
+  slides : uint32[n_slides * 2]
+  moves : uint8[(length + 3) / 4]
+
+REPLAY_MAGIC_V1 files, from before slides, have no n_slides and slides.
+*/
+
+#pragma once
+
+#include <sys/stat.h>
+#include "libunivoid.h"
+#include "utils.c"
+#include "generator.c"
+
+#define REPLAY_MAGIC 0x32525655 // "UVR2"
+#define REPLAY_MAGIC_V1 0x31525655 // "UVR1", no slides
+
+struct replay_result {
+  bool legal; // every move could be made the way it was recorded
+  bool solved; // the board was solved by the last move and not before
+  uint16_t moves; // moves used, as they would be on the leaderboard
+};
+
+// 2 bit codes of the moves. the index of a key is its code.
+static const Key replay_keys[] = { key_up, key_down, key_left, key_right };
+
+struct replay replay_init(uint32_t seed, Mode mode, int order) {
+  return (struct replay) { .seed = seed, .mode = mode, .order = order };
+}
+
+void replay_free(struct replay* r) {
+  free(r->moves);
+  free(r->marks);
+  free(r->slides);
+  r->moves = NULL;
+  r->marks = NULL;
+  r->slides = NULL;
+  r->length = r->capacity = r->n_marks = r->marks_capacity = r->n_slides = r->slides_capacity = 0;
+}
+
+static uint8_t replay_code(Key key) {
+  switch (key) {
+    case key_up : return 0;
+    case key_down : return 1;
+    case key_left : return 2;
+    default : return 3;
+  }
+}
+
+Key replay_move(const struct replay* r, uint32_t i) {
+  return replay_keys[(r->moves[i >> 2] >> ((i & 3) * 2)) & 3];
+}
+
+// records a move of the void-tile, a slide as every tile it moved. action
+// is key_undo or key_redo if the move came from the undo or redo stack,
+// anything else for regular moves.
+void replay_record(struct replay* r, Key key, Key action) {
+  int tiles = key_tiles(key);
+  while (r->length + tiles > r->capacity) {
+    r->capacity = (r->capacity == 0) ? 256 : r->capacity * 2;
+    r->moves = realloc(r->moves, r->capacity / 4);
+  }
+  if (tiles > 1) {
+    if (r->n_slides == r->slides_capacity) {
+      r->slides_capacity = (r->slides_capacity == 0) ? 16 : r->slides_capacity * 2;
+      r->slides = realloc(r->slides, sizeof(uint32_t) * 2 * r->slides_capacity);
+    }
+    r->slides[2 * r->n_slides] = r->length;
+    r->slides[2 * r->n_slides + 1] = tiles;
+    r->n_slides++;
+  }
+  if (action == key_undo || action == key_redo) {
+    if (r->n_marks == r->marks_capacity) {
+      r->marks_capacity = (r->marks_capacity == 0) ? 16 : r->marks_capacity * 2;
+      r->marks = realloc(r->marks, sizeof(uint32_t) * r->marks_capacity);
+    }
+    r->marks[r->n_marks++] = r->length << 1 | (action == key_redo);
+  }
+  for (int i = 0; i < tiles; i++) {
+    uint32_t byte = r->length >> 2, shift = (r->length & 3) * 2;
+    if (shift == 0) r->moves[byte] = 0;
+    r->moves[byte] |= replay_code(key_direction(key)) << shift;
+    r->length++;
+  }
+}
+
+// writes r at the current position of fp.
+bool replay_write(const struct replay* r, FILE* fp) {
+  uint32_t header[2] = { REPLAY_MAGIC, r->seed };
+  uint8_t deal[2] = { r->mode, r->order };
+  uint32_t counts[3] = { r->length, r->n_marks, r->n_slides };
+  return fwrite(header, sizeof(header), 1, fp) == 1 &&
+         fwrite(&r->finished, sizeof(r->finished), 1, fp) == 1 &&
+         fwrite(deal, sizeof(deal), 1, fp) == 1 &&
+         fwrite(counts, sizeof(counts), 1, fp) == 1 &&
+         fwrite(r->marks, sizeof(uint32_t), r->n_marks, fp) == r->n_marks &&
+         fwrite(r->slides, sizeof(uint32_t), r->n_slides * 2, fp) == r->n_slides * 2 &&
+         fwrite(r->moves, 1, (r->length + 3) / 4, fp) == (r->length + 3) / 4;
+}
+
+// reads a replay written by replay_write(). r must be freed with replay_free().
+bool replay_read(struct replay* r, FILE* fp) {
+  uint32_t header[2], counts[3] = { 0 };
+  uint8_t deal[2];
+  *r = (struct replay) { 0 };
+  if (fread(header, sizeof(header), 1, fp) != 1 || (header[0] != REPLAY_MAGIC && header[0] != REPLAY_MAGIC_V1) ||
+      fread(&r->finished, sizeof(r->finished), 1, fp) != 1 ||
+      fread(deal, sizeof(deal), 1, fp) != 1 ||
+      fread(counts, sizeof(uint32_t), (header[0] == REPLAY_MAGIC) ? 3 : 2, fp) != ((header[0] == REPLAY_MAGIC) ? 3 : 2)) {
+    return false;
+  }
+  // the counts come from the file. what they ask for has to be in it, which
+  // also keeps the sizes below from wrapping.
+  struct stat st;
+  long at = ftell(fp);
+  uint64_t needed = (uint64_t)counts[1] * sizeof(uint32_t) + (uint64_t)counts[2] * 2 * sizeof(uint32_t) + ((uint64_t)counts[0] + 3) / 4;
+  if (counts[0] > UINT32_MAX - 3 || at < 0 || fstat(fileno(fp), &st) != 0 || needed > (uint64_t)(st.st_size - at)) return false;
+  r->seed = header[1];
+  r->mode = deal[0];
+  r->order = deal[1];
+  r->length = counts[0];
+  r->n_marks = counts[1];
+  r->n_slides = counts[2];
+  // capacity is kept a multiple of 4 moves so recording can go on.
+  r->capacity = (r->length + 3) & ~3u;
+  r->marks_capacity = r->n_marks;
+  r->slides_capacity = r->n_slides;
+  r->moves = malloc(r->capacity / 4 + 1);
+  r->marks = malloc(sizeof(uint32_t) * r->n_marks + 1);
+  r->slides = malloc(sizeof(uint32_t) * 2 * r->n_slides + 1);
+  if (r->moves == NULL || r->marks == NULL || r->slides == NULL ||
+      fread(r->marks, sizeof(uint32_t), r->n_marks, fp) != r->n_marks ||
+      fread(r->slides, sizeof(uint32_t), r->n_slides * 2, fp) != r->n_slides * 2 ||
+      fread(r->moves, 1, (r->length + 3) / 4, fp) != (r->length + 3) / 4) {
+    replay_free(r);
+    return false;
+  }
+  // marks and slides point at moves, replay_verify() takes them as given.
+  bool ok = true;
+  for (uint32_t i = 0; i < r->n_marks && ok; i++) ok = (r->marks[i] >> 1) < r->length;
+  for (uint32_t i = 0; i < r->n_slides && ok; i++) ok = r->slides[2 * i] < r->length;
+  if (!ok) replay_free(r);
+  return ok;
+}
+
+// path of the replay of a game finished at given time.
+void replay_path(char* buf, size_t size, int64_t finished) {
+  snprintf(buf, size, "%s/%ld.uvr", REPLAY_DIR, (long)finished);
+}
+
+// saves r as the replay of a game finished at given time.
+bool replay_save(struct replay* r, int64_t finished) {
+  char path[128];
+  mkdir(REPLAY_DIR, 0755); // fails harmlessly if it exists
+  replay_path(path, sizeof(path), finished);
+  FILE* fp = fopen(path, "wb");
+  if (fp == NULL) return false;
+  r->finished = finished;
+  bool ok = replay_write(r, fp);
+  fclose(fp);
+  return ok;
+}
+
+// r can be handed to replay_free() whether this succeeds or not.
+bool replay_load(struct replay* r, const char* path) {
+  *r = (struct replay) { 0 };
+  FILE* fp = fopen(path, "rb");
+  if (fp == NULL) return false;
+  bool ok = replay_read(r, fp);
+  fclose(fp);
+  return ok;
+}
+
+// deals the game of r again and plays it move by move the way the game loop
+// does. gs must be a game_state of r->order, its contents are overwritten.
+void replay_verify(const struct replay* r, struct game_state* gs, struct replay_result* result) {
+  *result = (struct replay_result) { .legal = true };
+  if (r->order != gs->order || r->mode < mode_easy || r->mode > mode_custom) {
+    result->legal = false;
+    return;
+  }
+  gs->utop = gs->rtop = -1;
+  deal_game(gs, r->mode, r->seed);
+  uint32_t mark = 0, slide = 0;
+
+  for (uint32_t i = 0; i < r->length && result->legal; i++) {
+    Key key = replay_move(r, i);
+    uint32_t first = i;
+    if (slide < r->n_slides && r->slides[2 * slide] == i) {
+      // every tile of a slide moved the same way, then it is played as one.
+      uint32_t tiles = r->slides[2 * slide++ + 1];
+      if (tiles < 2 || tiles > r->length - i || tiles > CUSTOM_MAX_ORDER) {
+        result->legal = false;
+        break;
+      }
+      for (uint32_t j = 1; j < tiles; j++) {
+        if (replay_move(r, i + j) != key) result->legal = false;
+      }
+      key = slide_key(key, tiles);
+      i += tiles - 1;
+    }
+    bool undoing = mark < r->n_marks && (r->marks[mark] >> 1) == first;
+    if (undoing) {
+      // the move has to be exactly what the undo or redo stack holds.
+      bool redo = r->marks[mark++] & 1;
+      Key stacked = redo ? pop_key(gs->redo_stack, &gs->rtop) : pop_key(gs->undo_stack, &gs->utop);
+      if (stacked != key) {
+        result->legal = false;
+        break;
+      }
+      if (redo) push_key(gs->undo_stack, &gs->utop, key * -1);
+      else push_key(gs->redo_stack, &gs->rtop, key * -1);
+    }
+    // the game cuts slides down to the moves left, see slide_clamp().
+    if (!result->legal || (!undoing && slide_clamp(gs, key) != key) || mov_zero(gs, key) == count_stop) {
+      result->legal = false;
+      break;
+    }
+    if (!undoing) {
+      push_key(gs->undo_stack, &gs->utop, key * -1);
+      update_moves(gs, key);
+      if (gs->count_ctrl == count_down && gs->moves == 0) result->legal = false; // game over
+    }
+    // the game ends the moment the board is sorted.
+    if (i + 1 < r->length && is_sorted(gs)) result->legal = false;
+  }
+  if (mark != r->n_marks || slide != r->n_slides) result->legal = false; // marks in the middle of a slide
+  result->solved = result->legal && is_sorted(gs);
+  result->moves = moves_used(gs);
+}
@@ -1,9 +1,13 @@
 // this file contains functions to serialize and deserialize
 
 #pragma once
-#include "../lib/uni-void.c"
+#include "libunivoid.h"
+#include "utils.c"
+#include "replay.c"
 
-void save_game_state(struct game_state* gs) {
+// the replay of the game so far is saved along, so it can still be
+// verified once the game is finished.
+void save_game_state(struct game_state* gs, const struct replay* replay) {
   FILE *state_file = fopen(STATE_FILE, "wb");
   if (state_file == NULL) {
     perror("Failed to write to state file");
@@ -25,6 +29,9 @@ void save_game_state(struct game_state* gs) {
   for (int i = 0; i < gs->order; i++) {
     fwrite(gs->mat[i], sizeof(int), gs->order, state_file);
   }
+  // appended last so that older saves still load.
+  fwrite(&gs->move_limit, sizeof(typeof(gs->move_limit)), 1, state_file);
+  replay_write(replay, state_file);
 
   fclose(state_file);
 }
@@ -36,24 +43,25 @@ static size_t get_file_size(FILE* file) {
   return fsize;
 }
 
-struct game_state load_game_state(Arena* arena) {
+// returns a game_state of order 0 if there is no usable save.
+struct game_state load_game_state(Arena* arena, struct replay* replay) {
   FILE* state_file = fopen(STATE_FILE, "rb");
   if (state_file == NULL) {
-    perror("Failed to load state file");
-    endwin();
     return (struct game_state) {.order = 0};
   }
 
   size_t file_size = get_file_size(state_file);
   if (file_size < sizeof(uint16_t) * 3 + sizeof(uint16_t) * 2 + (sizeof(Key) * STK_SIZE * 2)) {
-    perror("Couldn't find any saved game state");
     fclose(state_file);
-    endwin();
-    exit(EXIT_FAILURE);
+    return (struct game_state) {.order = 0};
   }
 
   uint16_t order;
   fread(&order, sizeof(uint16_t), 1, state_file);
+  if (order < 2 || order > CUSTOM_MAX_ORDER) {
+    fclose(state_file);
+    return (struct game_state) {.order = 0};
+  }
   struct game_state gs = game_state_init(arena, order);
 
   fread(&gs.curs_x, sizeof(typeof(gs.curs_x)), 1, state_file);
@@ -69,7 +77,14 @@ struct game_state load_game_state(Arena* arena) {
   for (int i = 0; i < gs.order; i++) {
     fread(gs.mat[i], sizeof(int), gs.order, state_file);
   }
+  // saves from before move budgets keep the default limit.
+  if (fread(&gs.move_limit, sizeof(typeof(gs.move_limit)), 1, state_file) != 1) {
+    gs.move_limit = HARD_MODE_MOVE_LIMIT;
+  }
+  // so are saves without a replay. their games can't be verified.
+  replay_read(replay, state_file);
   fclose(state_file);
+  gs.hash = game_state_hash(&gs);
   return gs;
 }
 
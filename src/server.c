@@ -0,0 +1,379 @@
+/*
+Hosts the games of many players in one process: `uni-void serve [socket]`.
+
+Every connection to the unix socket is a session holding one game: its
+own arena for the board, the undo/redo stacks and the replay. Clients
+(`uni-void --connect [socket]`) only send the keys pressed and draw the
+boards they get back, so a player costs a few hundred bytes here instead
+of a whole process.
+
+A single thread drives every session with epoll. Sockets are non
+blocking. Requests are fixed size and handled in batches: every request
+that has arrived is applied, then one reply goes out for the last one.
+Only the first new game of a batch is dealt, the others get an error.
+Replies that can't be written right away are buffered until the socket
+is writable again. A client that keeps sending but never reads isn't
+read from while SERVER_OUT_MAX bytes of replies wait for it, so it can't
+make the server buffer without end.
+
+Finished games are put on the leaderboard here and nowhere else, so
+writes to LEADERBOARD_FILE never race. Dealing a hard game runs the
+solver for its move budget, a few milliseconds during which the other
+sessions wait.
+
+Games on a server aren't saved. A session ends with its connection.
+*/
+
+#pragma once
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "libunivoid.h"
+#include "utils.c"
+#include "generator.c"
+#include "replay.c"
+#include "leaderboard.c"
+
+// events taken from epoll at a time.
+#define SERVER_EVENTS 256
+
+// requests a session buffers before they are handled.
+#define SERVER_BATCH 64
+
+// replies a session may have waiting before the server stops reading its
+// requests. a batch adds at most a few KB on top of it.
+#define SERVER_OUT_MAX (64 * 1024)
+
+struct session {
+  int fd;
+  struct session* prev; // every open session, for shutting down
+  struct session* next;
+  Arena* arena; // the board of the current game
+  struct game_state gs;
+  struct replay replay;
+  Mode mode;
+  Outcome outcome;
+  time_t finished; // when the game was won
+  uint8_t in[sizeof(struct server_request) * SERVER_BATCH];
+  uint32_t in_len;
+  uint8_t* out; // replies not written yet
+  uint32_t out_len;
+  uint32_t out_cap;
+  uint32_t events; // what epoll watches the socket for
+};
+
+static volatile sig_atomic_t server_stop;
+
+static void server_signal(int sig) { server_stop = 1; }
+
+// seeds of the games dealt. deal_game() reseeds rand(), so it can't be used.
+static uint32_t server_seed() {
+  static uint64_t state;
+  if (state == 0) state = time(NULL) ^ getpid();
+  uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+static bool session_queue(struct session* s, const void* data, size_t size) {
+  if (s->out_len + size > s->out_cap) {
+    uint32_t cap = (s->out_cap == 0) ? 1024 : s->out_cap * 2;
+    while (cap < s->out_len + size) cap *= 2;
+    uint8_t* out = realloc(s->out, cap);
+    if (out == NULL) return false;
+    s->out = out;
+    s->out_cap = cap;
+  }
+  memcpy(s->out + s->out_len, data, size);
+  s->out_len += size;
+  return true;
+}
+
+static struct server_reply session_reply(const struct session* s, uint32_t seq, Reply type, uint16_t count) {
+  return (struct server_reply) {
+    .seq = seq,
+    .type = type,
+    .outcome = s->outcome,
+    .order = s->gs.order,
+    .mode = s->mode,
+    .moves = s->gs.moves,
+    .curs_x = s->gs.curs_x,
+    .curs_y = s->gs.curs_y,
+    .count = count,
+  };
+}
+
+static bool session_reply_board(struct session* s, uint32_t seq) {
+  int order = s->gs.order;
+  struct server_reply reply = session_reply(s, seq, reply_board, order * order);
+  uint16_t tiles[order * order + 1];
+  for (int i = 0; i < order; i++) {
+    for (int j = 0; j < order; j++) tiles[i * order + j] = s->gs.mat[i][j];
+  }
+  return session_queue(s, &reply, sizeof(reply)) && session_queue(s, tiles, sizeof(uint16_t) * order * order);
+}
+
+static bool session_reply_error(struct session* s, uint32_t seq) {
+  struct server_reply reply = session_reply(s, seq, reply_error, 0);
+  return session_queue(s, &reply, sizeof(reply));
+}
+
+// deals a new game into the session.
+static bool session_new(struct session* s, Mode mode, int order) {
+  if (mode < mode_easy || mode > mode_custom) return false;
+  if (mode != mode_custom) order = mode + MODE_OFFSET;
+  if (order < 2 || order > SERVER_MAX_ORDER) return false;
+  arena_free(s->arena);
+  s->arena = arena_init(sizeof(int*) * order + sizeof(int) * order * order + 64);
+  if (s->arena == NULL) return false;
+  uint32_t seed = server_seed();
+  s->gs = game_state_init(s->arena, order);
+  deal_game(&s->gs, mode, seed);
+  replay_free(&s->replay);
+  s->replay = replay_init(seed, mode, order);
+  s->mode = mode;
+  s->outcome = outcome_playing;
+  return true;
+}
+
+// applies a key the way the game loop in main.c does.
+static void session_key(struct session* s, Key key) {
+  struct game_state* gs = &s->gs;
+  Key action = key;
+  bool undoing = false;
+  if (s->outcome != outcome_playing) return;
+  if (key == key_undo) {
+    if ((key = pop_key(gs->undo_stack, &gs->utop)) == key_invalid) return;
+    push_key(gs->redo_stack, &gs->rtop, key * -1);
+    undoing = true;
+  } else if (key == key_redo) {
+    if ((key = pop_key(gs->redo_stack, &gs->rtop)) == key_invalid) return;
+    push_key(gs->undo_stack, &gs->utop, key * -1);
+    undoing = true;
+  }
+  if (mov_zero(gs, key) == count_stop) {
+    if (undoing) unpop_key(gs, action, key);
+    return;
+  }
+  replay_record(&s->replay, key, action);
+  if (!undoing) {
+    push_key(gs->undo_stack, &gs->utop, key * -1);
+    update_moves(gs, key);
+    if (gs->count_ctrl == count_down && gs->moves == 0) {
+      s->outcome = outcome_lost;
+      return;
+    }
+  }
+  if (is_sorted(gs)) {
+    s->outcome = outcome_won;
+    s->finished = time(NULL);
+  }
+}
+
+// the name goes into the leaderboard csv as it is (see save_record()), so
+// quotes, commas and control characters, which would break or forge rows,
+// are dropped. names are cut to SERVER_NAME_MAX - 1, shorter than what the
+// prompt of the game takes anyway.
+static void session_clean_name(char* name) {
+  size_t j = 0;
+  for (size_t i = 0; i < SERVER_NAME_MAX - 1 && name[i] != '\0'; i++) {
+    uint8_t c = name[i];
+    if (c < 0x20 || c == 0x7f || c == ',' || c == '"') continue;
+    name[j++] = c;
+  }
+  name[j] = '\0';
+}
+
+// puts the won game of the session on the leaderboard and replies with it.
+static bool session_name(struct session* s, uint32_t seq, char* name) {
+  if (s->outcome != outcome_won) return session_reply_error(s, seq);
+  session_clean_name(name);
+  csv_arena = arena_init(1024);
+  if (csv_arena == NULL) return false;
+  struct leaderboard_record new_record = leader_board_init(s->gs.order, moves_used(&s->gs), name, s->finished);
+  struct leaderboard_record records[LEADERBOARD_ENTRIES];
+  uint32_t count = submit_record(&new_record, s->mode, records);
+  replay_save(&s->replay, s->finished);
+  s->outcome = outcome_none; // it can't be submitted twice
+
+  struct server_reply reply = session_reply(s, seq, reply_leaderboard, count);
+  reply.moves = new_record.moves; // as on the leaderboard, the counter may run down
+  bool ok = session_queue(s, &reply, sizeof(reply));
+  for (uint32_t i = 0; i < count && ok; i++) {
+    struct server_record record = { .time = records[i].time, .order = records[i].order, .moves = records[i].moves };
+    strncpy(record.player_name, records[i].player_name, SERVER_NAME_MAX - 1);
+    ok = session_queue(s, &record, sizeof(record));
+  }
+  arena_free(csv_arena);
+  return ok;
+}
+
+// handles every complete request in the input buffer.
+static bool session_handle(struct session* s) {
+  uint32_t n = s->in_len / sizeof(struct server_request), seq = 0;
+  bool board_due = false, dealt = false;
+  for (uint32_t i = 0; i < n; i++) {
+    struct server_request req;
+    memcpy(&req, s->in + i * sizeof(req), sizeof(req));
+    seq = req.seq;
+    switch (req.type) {
+      case req_new :
+        // dealing can run the solver, so a batch deals one game at most
+        // and the other sessions don't wait on a client flooding requests.
+        board_due = !dealt && session_new(s, req.mode, req.order);
+        dealt = true;
+        if (!board_due && !session_reply_error(s, seq)) return false;
+        break;
+      case req_key :
+        if (s->gs.order != 0) session_key(s, req.key);
+        board_due = (s->gs.order != 0);
+        break;
+      case req_name :
+        if (!session_name(s, seq, req.name)) return false;
+        board_due = false;
+        break;
+      default :
+        if (!session_reply_error(s, seq)) return false;
+        board_due = false;
+        break;
+    }
+  }
+  // a partial request stays for the next read.
+  memmove(s->in, s->in + n * sizeof(struct server_request), s->in_len - n * sizeof(struct server_request));
+  s->in_len -= n * sizeof(struct server_request);
+  return !board_due || session_reply_board(s, seq);
+}
+
+// writes as much of the buffered replies as the socket takes.
+// returns false if the connection is gone.
+static bool session_flush(struct session* s, int epfd) {
+  uint32_t written = 0;
+  while (written < s->out_len) {
+    ssize_t n = send(s->fd, s->out + written, s->out_len - written, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    if (n <= 0) return false;
+    written += n;
+  }
+  memmove(s->out, s->out + written, s->out_len - written);
+  s->out_len -= written;
+
+  // only ask for writability while there is something left to write, and
+  // only take requests while the replies are under the cap.
+  uint32_t events = ((s->out_len < SERVER_OUT_MAX) ? EPOLLIN : 0) | ((s->out_len > 0) ? EPOLLOUT : 0);
+  if (events != s->events) {
+    struct epoll_event ev = { .events = events, .data.ptr = s };
+    epoll_ctl(epfd, EPOLL_CTL_MOD, s->fd, &ev);
+    s->events = events;
+  }
+  return true;
+}
+
+// reads what the client sent. returns false if the connection is gone.
+static bool session_read(struct session* s) {
+  while (s->out_len < SERVER_OUT_MAX) {
+    ssize_t n = recv(s->fd, s->in + s->in_len, sizeof(s->in) - s->in_len, 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+    if (n <= 0) return false;
+    s->in_len += n;
+    if (!session_handle(s)) return false;
+  }
+  return true; // the rest waits until the client reads its replies
+}
+
+static void session_close(struct session* s, struct session** sessions) {
+  if (s->prev) s->prev->next = s->next; else *sessions = s->next;
+  if (s->next) s->next->prev = s->prev;
+  close(s->fd);
+  replay_free(&s->replay);
+  arena_free(s->arena);
+  free(s->out);
+  free(s);
+}
+
+static int server_listen(const char* path) {
+  struct sockaddr_un addr = { .sun_family = AF_UNIX };
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "serve: socket path too long\n");
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    perror("serve: socket");
+    return -1;
+  }
+  unlink(path); // left behind by a server that didn't shut down
+  if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+    perror("serve: bind");
+    close(fd);
+    return -1;
+  }
+  chmod(path, 0666); // every user of the box may play
+  return fd;
+}
+
+int server_run(const char* path) {
+  int listener = server_listen(path);
+  if (listener < 0) return 1;
+  int epfd = epoll_create1(EPOLL_CLOEXEC);
+  struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL }, events[SERVER_EVENTS];
+  epoll_ctl(epfd, EPOLL_CTL_ADD, listener, &ev);
+  signal(SIGINT, server_signal);
+  signal(SIGTERM, server_signal);
+
+  struct session* sessions = NULL;
+  uint64_t served = 0;
+  printf("serving on %s\n", path);
+  fflush(stdout);
+
+  while (!server_stop) {
+    int n = epoll_wait(epfd, events, SERVER_EVENTS, -1);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) {
+      perror("serve: epoll_wait");
+      break;
+    }
+    for (int i = 0; i < n; i++) {
+      struct session* s = events[i].data.ptr;
+      if (s == NULL) { // new connections
+        int fd;
+        while ((fd = accept(listener, NULL, NULL)) >= 0) {
+          fcntl(fd, F_SETFL, O_NONBLOCK);
+          s = calloc(1, sizeof(struct session));
+          if (s == NULL) {
+            close(fd);
+            continue;
+          }
+          s->fd = fd;
+          s->events = EPOLLIN;
+          s->next = sessions;
+          if (sessions) sessions->prev = s;
+          sessions = s;
+          struct epoll_event sev = { .events = EPOLLIN, .data.ptr = s };
+          epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &sev);
+          served++;
+        }
+        continue;
+      }
+      bool alive = !(events[i].events & EPOLLERR);
+      if (alive && (events[i].events & (EPOLLIN | EPOLLHUP))) alive = session_read(s);
+      if (alive) alive = session_flush(s, epfd);
+      if (!alive) session_close(s, &sessions);
+    }
+  }
+
+  while (sessions) session_close(sessions, &sessions);
+  close(listener);
+  close(epfd);
+  unlink(path);
+  printf("served %lu sessions\n", served);
+  return 0;
+}
@@ -0,0 +1,205 @@
+/*
+Optimal solutions kept on disk, shared by every process that plays from
+the same game_files/.
+
+Seeded games and the daily boards come up again and again, in one game
+and across restarts, and an optimal 4x4 search can take seconds. So
+every optimal solution a search finds can go to SOLUTION_CACHE_FILE, and
+the next search of the same board (in any process) reads it from there.
+
+The file is a header and SOLUTION_CACHE_SLOTS slots, mapped MAP_SHARED
+and used as an open addressing hash table with linear probing. The slot
+of a board is picked by its zobrist hash (see zobrist.c, the same in
+every process), and the board itself is stored in a canonical encoding
+to tell collisions apart: the order, then 5 bits for every tile but the
+last one, which is implied. That covers boards up to
+SOLUTION_CACHE_MAX_ORDER, optimal searches don't get further anyway.
+Moves are 2 bits each, like in replay files.
+
+  - slots are only ever appended: once filled, a slot never changes and
+    is never removed. a writer holds flock() on the file (and a mutex,
+    flock() doesn't keep threads of one process apart), fills a free
+    slot and marks it filled last, with a release store.
+  - readers take no lock at all. a slot that reads as filled is complete,
+    a probe stops at the first empty slot.
+  - once 3/4 of the slots are taken, no more solutions are stored. delete
+    the file to start over.
+  - the header has a version. a file of any other version is replaced by
+    an empty one, that's how solutions of older, buggy solvers go away.
+
+Every solution read is replayed on the board before it is handed out
+(see solver.c), so a damaged file costs a search, never a wrong move.
+*/
+
+#pragma once
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../lib/uni-void.c"
+
+#define SOLUTION_CACHE_MAGIC 0x756e69766f696473ULL // "univoids"
+// bumped whenever the layout changes or files of older builds can't be
+// trusted. 2: solvers before it could store solutions that weren't
+// optimal, see tt_new_search().
+#define SOLUTION_CACHE_VERSION 2
+#define SOLUTION_CACHE_SLOTS (1 << 16) // a power of two, about 6 MB
+#define SOLUTION_CACHE_MAX_ORDER 5 // 24 tiles of 5 bits fit the board encoding
+#define SOLUTION_CACHE_BOARD 16 // bytes of a board encoding
+#define SOLUTION_CACHE_MAX_LENGTH 256 // longest solution stored, SOLVER_MAX_DEPTH
+
+struct solution_slot {
+  _Atomic uint32_t filled; // set last, once the rest is written
+  uint16_t length;
+  uint8_t board[SOLUTION_CACHE_BOARD];
+  uint8_t moves[SOLUTION_CACHE_MAX_LENGTH / 4];
+};
+
+struct solution_cache_header {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t slots;
+  _Atomic uint32_t used;
+};
+
+struct solution_cache {
+  int fd;
+  struct solution_cache_header* header;
+  struct solution_slot* slots;
+  pthread_mutex_t lock; // writers of this process
+};
+
+static struct solution_cache* solution_cache;
+static pthread_once_t solution_cache_once = PTHREAD_ONCE_INIT;
+
+static const Key solution_keys[] = { key_up, key_down, key_left, key_right };
+
+static uint8_t solution_code(Key key) {
+  for (uint8_t i = 0; i < 4; i++) {
+    if (solution_keys[i] == key) return i;
+  }
+  return 0;
+}
+
+// canonical encoding of a board, see above. false if it is too big.
+static bool solution_board(uint8_t board[SOLUTION_CACHE_BOARD], const uint8_t* tiles, int order) {
+  if (order < 2 || order > SOLUTION_CACHE_MAX_ORDER) return false;
+  memset(board, 0, SOLUTION_CACHE_BOARD);
+  board[0] = order;
+  for (int i = 0, bit = 8; i < order * order - 1; i++, bit += 5) {
+    uint16_t bits = (uint16_t)tiles[i] << (bit & 7);
+    board[bit >> 3] |= bits;
+    if ((bit & 7) > 3) board[(bit >> 3) + 1] |= bits >> 8;
+  }
+  return true;
+}
+
+static bool solution_cache_header_ok(const struct solution_cache_header* header) {
+  return header->magic == SOLUTION_CACHE_MAGIC && header->version == SOLUTION_CACHE_VERSION && header->slots == SOLUTION_CACHE_SLOTS;
+}
+
+static void solution_cache_open() {
+  size_t bytes = sizeof(struct solution_cache_header) + sizeof(struct solution_slot) * SOLUTION_CACHE_SLOTS;
+  struct solution_cache_header* header = NULL;
+  int fd = -1;
+  // a file of another version is thrown away and a new one is made. it is
+  // unlinked rather than rewritten, processes that still have it mapped
+  // keep using their copy.
+  for (int attempt = 0; attempt < 2 && header == NULL; attempt++) {
+    if ((fd = open(SOLUTION_CACHE_FILE, O_RDWR | O_CREAT, 0644)) < 0) return;
+    struct stat st;
+    // a fresh file is zero filled. the first process sizes it and writes
+    // the header, under the lock so that two of them don't race.
+    if (flock(fd, LOCK_EX) != 0 || fstat(fd, &st) != 0 ||
+        (st.st_size < (off_t)bytes && ftruncate(fd, bytes) != 0)) {
+      close(fd);
+      return;
+    }
+    void* mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED) {
+      close(fd);
+      return;
+    }
+    header = mem;
+    if (header->magic == 0) {
+      header->version = SOLUTION_CACHE_VERSION;
+      header->slots = SOLUTION_CACHE_SLOTS;
+      header->magic = SOLUTION_CACHE_MAGIC;
+    }
+    if (!solution_cache_header_ok(header)) {
+      unlink(SOLUTION_CACHE_FILE);
+      munmap(mem, bytes);
+      header = NULL;
+    }
+    flock(fd, LOCK_UN);
+    if (header == NULL) close(fd);
+  }
+  if (header == NULL) return;
+  if ((solution_cache = malloc(sizeof(struct solution_cache))) == NULL) {
+    munmap(header, bytes);
+    close(fd);
+    return;
+  }
+  solution_cache->fd = fd;
+  solution_cache->header = header;
+  solution_cache->slots = (struct solution_slot*)(header + 1);
+  pthread_mutex_init(&solution_cache->lock, NULL);
+}
+
+// the cache of game_files/, opened on first use. NULL if it can't be used,
+// the solvers simply search then.
+struct solution_cache* solution_cache_get() {
+  pthread_once(&solution_cache_once, solution_cache_open);
+  return solution_cache;
+}
+
+// slot holding board, or the empty slot it would go to. NULL if neither
+// turned up, the table is never filled that far.
+static struct solution_slot* solution_cache_find(struct solution_cache* sc, const uint8_t* board, uint64_t hash) {
+  uint32_t mask = SOLUTION_CACHE_SLOTS - 1;
+  for (uint32_t i = hash & mask, probes = 0; probes < SOLUTION_CACHE_SLOTS; i = (i + 1) & mask, probes++) {
+    struct solution_slot* slot = &sc->slots[i];
+    if (!atomic_load_explicit(&slot->filled, memory_order_acquire)) return slot;
+    if (memcmp(slot->board, board, SOLUTION_CACHE_BOARD) == 0) return slot;
+  }
+  return NULL;
+}
+
+// reads the solution of the board (tiles in reading order, hash is its
+// zobrist hash) into solution, which must hold SOLUTION_CACHE_MAX_LENGTH
+// keys. returns its length, -1 if the board isn't in the cache.
+int solution_cache_lookup(struct solution_cache* sc, const uint8_t* tiles, int order, uint64_t hash, Key* solution) {
+  uint8_t board[SOLUTION_CACHE_BOARD];
+  if (!solution_board(board, tiles, order)) return -1;
+  struct solution_slot* slot = solution_cache_find(sc, board, hash);
+  if (slot == NULL || !atomic_load_explicit(&slot->filled, memory_order_acquire)) return -1;
+  int length = (slot->length < SOLUTION_CACHE_MAX_LENGTH) ? slot->length : SOLUTION_CACHE_MAX_LENGTH;
+  for (int i = 0; i < length; i++) solution[i] = solution_keys[(slot->moves[i >> 2] >> ((i & 3) * 2)) & 3];
+  return length;
+}
+
+// appends the solution of a board, unless it is there already or the
+// table is full.
+void solution_cache_store(struct solution_cache* sc, const uint8_t* tiles, int order, uint64_t hash, const Key* solution, int length) {
+  uint8_t board[SOLUTION_CACHE_BOARD];
+  if (length < 0 || length > SOLUTION_CACHE_MAX_LENGTH || !solution_board(board, tiles, order)) return;
+  if (atomic_load(&sc->header->used) * 4 >= SOLUTION_CACHE_SLOTS * 3) return;
+
+  pthread_mutex_lock(&sc->lock);
+  if (flock(sc->fd, LOCK_EX) == 0) {
+    struct solution_slot* slot = solution_cache_find(sc, board, hash);
+    if (slot != NULL && !atomic_load_explicit(&slot->filled, memory_order_relaxed)) {
+      memcpy(slot->board, board, SOLUTION_CACHE_BOARD);
+      slot->length = length;
+      memset(slot->moves, 0, sizeof(slot->moves));
+      for (int i = 0; i < length; i++) slot->moves[i >> 2] |= solution_code(solution[i]) << ((i & 3) * 2);
+      atomic_store_explicit(&slot->filled, 1, memory_order_release);
+      atomic_fetch_add(&sc->header->used, 1);
+    }
+    flock(sc->fd, LOCK_UN);
+  }
+  pthread_mutex_unlock(&sc->lock);
+}
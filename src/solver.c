@@ -0,0 +1,704 @@
+/*
+This file contains the optimal puzzle solvers.
+
+The game matrix (int** mat) is convenient for rendering but slow to
+search, so the solvers work on a flat copy of the board (struct puzzle)
+where every cell is a byte and the void-tile is tracked by its index.
+Moves use the same Key encoding as the game, so a solution can be fed
+straight into mov_zero().
+
+  - ida_star() : iterative deepening A*, guided by manhattan distance
+                 and (optionally) linear conflicts. 4x4 boards can also
+                 use the walking distance (see walking_distance.c).
+  - parallel_ida_star() : same search, but the top levels of the tree are
+                 expanded into a frontier of subproblems which are handed
+                 out to a pool of threads. Every thread owns a deque of
+                 subproblems and steals from the others once it runs dry.
+                 All threads share the current f-bound, so the first
+                 solution found is an optimal one and it cancels the rest.
+
+Both searches can share a transposition table (see transposition.c) to
+skip states that were already searched with at least as much budget, and
+both look the board up in the solution cache (see solution_cache.c)
+before searching at all.
+*/
+
+#pragma once
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../lib/uni-void.c"
+#include "utils.c"
+#include "zobrist.c"
+#include "transposition.c"
+#include "walking_distance.c"
+#include "solution_cache.c"
+
+// largest board the solvers can handle.
+#define SOLVER_MAX_ORDER 16
+#define SOLVER_MAX_CELLS (SOLVER_MAX_ORDER * SOLVER_MAX_ORDER)
+
+// longest solution the optimal solvers will look for.
+#define SOLVER_MAX_DEPTH 256
+
+// returned by the solvers when no solution was found.
+#define SOLVER_FAILED -1
+
+// subproblems generated per thread by parallel_ida_star().
+#define FRONTIER_PER_THREAD 64
+#define FRONTIER_MAX_DEPTH 16
+
+typedef enum {
+  heur_manhattan,
+  heur_linear_conflict, // manhattan distance + linear conflicts
+  heur_walking_distance, // the larger of walking distance and the above. 4x4 only
+} Heuristic;
+
+// flat representation of a board used by the solvers.
+struct puzzle {
+  uint8_t order;
+  uint8_t zero; // index of the void-tile
+  uint8_t tiles[SOLVER_MAX_CELLS];
+};
+
+struct solver_config {
+  Heuristic heuristic;
+  int threads; // used by parallel_ida_star()
+  uint64_t node_limit; // give up after expanding this many nodes. 0 = no limit
+  atomic_bool* cancel; // search stops as soon as this is set. may be NULL
+  struct transposition_table* tt; // may be NULL
+  struct solution_cache* cache; // consulted before searching, found solutions go there. may be NULL
+};
+
+struct solver_stats {
+  uint64_t nodes; // expanded nodes
+  double seconds; // wall time of the search
+  struct tt_stats tt;
+};
+
+// every move the void-tile can make.
+static const Key solver_moves[] = { key_up, key_down, key_left, key_right };
+
+// initializes p to the solved board of given order.
+void puzzle_goal(struct puzzle* p, int order) {
+  int size = order * order;
+  p->order = order;
+  for (int i = 0; i < size - 1; i++) p->tiles[i] = i + 1;
+  p->tiles[size - 1] = 0;
+  p->zero = size - 1;
+}
+
+void puzzle_from_game_state(struct puzzle* p, const struct game_state* gs) {
+  p->order = gs->order;
+  for (int i = 0; i < gs->order; i++) {
+    for (int j = 0; j < gs->order; j++) {
+      p->tiles[i * gs->order + j] = gs->mat[i][j];
+    }
+  }
+  p->zero = gs->curs_x * gs->order + gs->curs_y;
+}
+
+// copies p onto the matrix of gs, which must have the same order.
+void puzzle_to_game_state(const struct puzzle* p, struct game_state* gs) {
+  for (int i = 0; i < gs->order; i++) {
+    for (int j = 0; j < gs->order; j++) {
+      gs->mat[i][j] = p->tiles[i * gs->order + j];
+    }
+  }
+  gs->curs_x = p->zero / gs->order;
+  gs->curs_y = p->zero % gs->order;
+  gs->hash = game_state_hash(gs);
+}
+
+// returns the cell the void-tile moves into on key, -1 if it would leave the board.
+static inline int puzzle_move_target(int order, int zero, Key key) {
+  switch (key) {
+    case key_up : return (zero >= order) ? zero - order : -1;
+    case key_down : return (zero < order * (order - 1)) ? zero + order : -1;
+    case key_left : return (zero % order != 0) ? zero - 1 : -1;
+    case key_right : return (zero % order != order - 1) ? zero + 1 : -1;
+    default : return -1;
+  }
+}
+
+// applies key to p the same way mov_zero() does. returns false on illegal moves.
+bool puzzle_move(struct puzzle* p, Key key) {
+  int target = puzzle_move_target(p->order, p->zero, key);
+  if (target < 0) return false;
+  p->tiles[p->zero] = p->tiles[target];
+  p->tiles[target] = 0;
+  p->zero = target;
+  return true;
+}
+
+uint64_t puzzle_hash(const struct puzzle* p) {
+  uint64_t hash = 0;
+  for (int i = 0; i < p->order * p->order; i++) hash ^= zobrist_key(p->tiles[i], i);
+  return hash;
+}
+
+bool puzzle_is_goal(const struct puzzle* p) {
+  int size = p->order * p->order;
+  for (int i = 0; i < size - 1; i++) {
+    if (p->tiles[i] != i + 1) return false;
+  }
+  return true;
+}
+
+// shuffles p with a random walk of given length starting from the solved board.
+// passing 0 moves produces a uniformly random solvable board instead.
+void puzzle_scramble(struct puzzle* p, int order, int moves) {
+  if (moves == 0) {
+    int size = order * order, arr[size];
+    do {
+      make_radomized_array(arr, size);
+    } while (!is_solvable(arr, order));
+    p->order = order;
+    for (int i = 0; i < size; i++) {
+      p->tiles[i] = arr[i];
+      if (arr[i] == 0) p->zero = i;
+    }
+    return;
+  }
+
+  Key prev = key_invalid, key;
+  puzzle_goal(p, order);
+  while (moves > 0) {
+    key = solver_moves[rand() % 4];
+    if (key == -prev || !puzzle_move(p, key)) continue;
+    prev = key;
+    moves--;
+  }
+}
+
+// state of a single depth-first search. the board is modified in place
+// and the heuristic is updated incrementally on every move.
+struct search {
+  struct puzzle p;
+  Heuristic heuristic;
+  uint8_t goal_row[SOLVER_MAX_CELLS]; // goal row of every tile
+  uint8_t goal_col[SOLVER_MAX_CELLS]; // goal column of every tile
+  uint8_t conflicts[SOLVER_MAX_ORDER * 2]; // conflicts of each row, followed by each column
+  int md; // sum of manhattan distances
+  int lc; // sum of line conflicts
+  const struct wd_table* wd; // walking distance table, NULL if not used
+  uint16_t wd_row, wd_col; // walking distance states of the rows and the columns
+  int bound; // current f-bound
+  int next_bound; // smallest f that exceeded the bound
+  int length; // solution length once found
+  bool stopped; // search was cut short
+  uint64_t nodes;
+  uint64_t node_limit;
+  atomic_bool* cancel;
+  atomic_bool* found; // set when another thread found a solution
+  struct transposition_table* tt;
+  struct tt_stats tt_stats;
+  uint64_t hash; // zobrist hash of p, only kept when tt is used
+  uint16_t tt_generation; // of this search in tt, see tt_new_search()
+  Key path[SOLVER_MAX_DEPTH];
+};
+
+// saved by search_apply() so a move can be taken back.
+struct search_undo {
+  int md, lc;
+  uint16_t wd_row, wd_col;
+  uint8_t line[2];
+  uint8_t conflicts[2];
+};
+
+// number of tiles that have to leave a line so that the remaining tiles
+// of that line are in goal order. ie, tiles in line minus the longest
+// increasing subsequence of their goal positions.
+static int line_conflicts(const struct search* s, int line) {
+  int order = s->p.order, seq[SOLVER_MAX_ORDER], lis[SOLVER_MAX_ORDER], len = 0, longest = 0;
+  bool is_row = line < order;
+  int k = is_row ? line : line - order;
+
+  for (int i = 0; i < order; i++) {
+    int tile = s->p.tiles[is_row ? k * order + i : i * order + k];
+    if (tile == 0) continue;
+    if (is_row && s->goal_row[tile] == k) seq[len++] = s->goal_col[tile];
+    else if (!is_row && s->goal_col[tile] == k) seq[len++] = s->goal_row[tile];
+  }
+  for (int i = 0; i < len; i++) {
+    lis[i] = 1;
+    for (int j = 0; j < i; j++) {
+      if (seq[j] < seq[i] && lis[j] + 1 > lis[i]) lis[i] = lis[j] + 1;
+    }
+    if (lis[i] > longest) longest = lis[i];
+  }
+  return len - longest;
+}
+
+static inline int search_h(const struct search* s) {
+  int h = s->md + 2 * s->lc;
+  if (s->wd) {
+    int wd = s->wd->dist[s->wd_row] + s->wd->dist[s->wd_col];
+    if (wd > h) h = wd;
+  }
+  return h;
+}
+
+// sets the goal tiles are measured against. goal == NULL means the solved board.
+static void search_set_goal(struct search* s, const struct puzzle* goal) {
+  int order = s->p.order, size = order * order;
+  for (int i = 0; i < size; i++) {
+    int tile = goal ? goal->tiles[i] : (i + 1) % size;
+    s->goal_row[tile] = i / order;
+    s->goal_col[tile] = i % order;
+  }
+}
+
+// recomputes the heuristic of the current board from scratch.
+static void search_eval(struct search* s) {
+  int order = s->p.order, size = order * order;
+  s->md = 0;
+  s->lc = 0;
+  for (int i = 0; i < size; i++) {
+    int tile = s->p.tiles[i];
+    if (tile == 0) continue;
+    s->md += abs(i / order - s->goal_row[tile]) + abs(i % order - s->goal_col[tile]);
+  }
+  for (int line = 0; line < order * 2; line++) {
+    s->conflicts[line] = (s->heuristic == heur_manhattan) ? 0 : line_conflicts(s, line);
+    s->lc += s->conflicts[line];
+  }
+  if (s->wd) {
+    s->wd_row = wd_index(s->wd, s->p.tiles, false);
+    s->wd_col = wd_index(s->wd, s->p.tiles, true);
+  }
+}
+
+static void search_init(struct search* s, const struct puzzle* p, const struct puzzle* goal, const struct solver_config* cfg) {
+  s->p = *p;
+  s->heuristic = cfg->heuristic;
+  s->nodes = 0;
+  s->node_limit = cfg->node_limit;
+  s->cancel = cfg->cancel;
+  s->found = NULL;
+  s->tt = cfg->tt;
+  s->tt_stats = (struct tt_stats) { 0 };
+  s->hash = cfg->tt ? puzzle_hash(p) : 0;
+  s->stopped = false;
+  s->length = SOLVER_FAILED;
+  // the walking distance tables only know the solved 4x4 board, other
+  // searches fall back to linear conflicts.
+  s->wd = NULL;
+  if (s->heuristic == heur_walking_distance) {
+    if (p->order == WD_ORDER && goal == NULL) s->wd = wd_table_get();
+    if (s->wd == NULL) s->heuristic = heur_linear_conflict;
+  }
+  search_set_goal(s, goal);
+  search_eval(s);
+}
+
+// slides the tile at cell `from` into the void-tile.
+static void search_apply(struct search* s, int from, struct search_undo* u) {
+  int order = s->p.order, zero = s->p.zero, tile = s->p.tiles[from];
+  u->md = s->md;
+  u->lc = s->lc;
+  u->wd_row = s->wd_row;
+  u->wd_col = s->wd_col;
+
+  s->md += abs(zero / order - s->goal_row[tile]) + abs(zero % order - s->goal_col[tile])
+         - abs(from / order - s->goal_row[tile]) - abs(from % order - s->goal_col[tile]);
+  s->p.tiles[zero] = tile;
+  s->p.tiles[from] = 0;
+  s->p.zero = from;
+  if (s->tt) s->hash ^= zobrist_slide(tile, from, zero);
+
+  if (s->wd) {
+    // the void leaves for the row (or column) of from, taking tile's goal
+    // row (or column) into the line it came from.
+    if (zero / order == from / order) {
+      s->wd_col = s->wd->link[s->wd_col][from < zero ? 0 : 1][s->goal_col[tile]];
+    } else {
+      s->wd_row = s->wd->link[s->wd_row][from < zero ? 0 : 1][s->goal_row[tile]];
+    }
+  }
+  if (s->heuristic == heur_manhattan) return;
+  // a tile moving sideways only changes the columns it leaves and enters,
+  // a tile moving up or down only changes rows.
+  if (zero / order == from / order) {
+    u->line[0] = order + zero % order;
+    u->line[1] = order + from % order;
+  } else {
+    u->line[0] = zero / order;
+    u->line[1] = from / order;
+  }
+  for (int i = 0; i < 2; i++) {
+    u->conflicts[i] = s->conflicts[u->line[i]];
+    s->conflicts[u->line[i]] = line_conflicts(s, u->line[i]);
+    s->lc += s->conflicts[u->line[i]] - u->conflicts[i];
+  }
+}
+
+static void search_undo(struct search* s, int zero, const struct search_undo* u) {
+  int from = s->p.zero;
+  if (s->tt) s->hash ^= zobrist_slide(s->p.tiles[zero], from, zero);
+  s->p.tiles[from] = s->p.tiles[zero];
+  s->p.tiles[zero] = 0;
+  s->p.zero = zero;
+  s->md = u->md;
+  s->lc = u->lc;
+  s->wd_row = u->wd_row;
+  s->wd_col = u->wd_col;
+  if (s->heuristic == heur_manhattan) return;
+  for (int i = 1; i >= 0; i--) s->conflicts[u->line[i]] = u->conflicts[i];
+}
+
+static inline bool search_should_stop(struct search* s) {
+  if ((s->nodes & 1023) == 0) {
+    if ((s->cancel && atomic_load_explicit(s->cancel, memory_order_relaxed)) ||
+        (s->found && atomic_load_explicit(s->found, memory_order_relaxed)) ||
+        (s->node_limit && s->nodes >= s->node_limit)) {
+      s->stopped = true;
+    }
+  }
+  return s->stopped;
+}
+
+// depth-first search bounded by s->bound. g is the depth of the current
+// node and prev is the move that lead here, which is never undone.
+static bool ida_dfs(struct search* s, int g, Key prev) {
+  int f = g + search_h(s);
+  if (f > s->bound) {
+    if (f < s->next_bound) s->next_bound = f;
+    return false;
+  }
+  if (s->md == 0) {
+    s->length = g;
+    return true;
+  }
+  if (search_should_stop(s)) return false;
+  s->nodes++;
+
+  // a state already searched in this iteration from the same or a
+  // shallower depth can't lead to anything new.
+  if (s->tt) {
+    uint64_t data;
+    if (tt_probe(s->tt, s->hash, s->tt_generation, &data, &s->tt_stats) && tt_bound(data) == s->bound && tt_g(data) <= g) return false;
+    tt_store(s->tt, s->hash, tt_pack(s->bound, g, s->tt_generation, s->bound - g), &s->tt_stats);
+  }
+
+  int zero = s->p.zero;
+  for (int i = 0; i < 4; i++) {
+    Key key = solver_moves[i];
+    if (key == -prev) continue;
+    int from = puzzle_move_target(s->p.order, zero, key);
+    if (from < 0) continue;
+
+    struct search_undo u;
+    search_apply(s, from, &u);
+    s->path[g] = key;
+    if (ida_dfs(s, g + 1, key)) return true;
+    search_undo(s, zero, &u);
+    if (s->stopped) return false;
+  }
+  return false;
+}
+
+// finds a shortest path from p to goal (the solved board when NULL) that is
+// not longer than max_depth. moves are written to solution, which must hold
+// max_depth keys. returns length of the path or SOLVER_FAILED.
+int ida_search(const struct puzzle* p, const struct puzzle* goal, int max_depth, Key* solution, const struct solver_config* cfg, struct solver_stats* stats) {
+  struct search* s = malloc(sizeof(struct search));
+  if (s == NULL) return SOLVER_FAILED;
+  double start = monotonic_seconds();
+  int length = SOLVER_FAILED;
+
+  if (max_depth > SOLVER_MAX_DEPTH) max_depth = SOLVER_MAX_DEPTH;
+  search_init(s, p, goal, cfg);
+  if (s->tt) s->tt_generation = tt_new_search(s->tt);
+  s->bound = search_h(s);
+  while (s->bound <= max_depth) {
+    s->next_bound = INT_MAX;
+    if (ida_dfs(s, 0, key_invalid)) {
+      length = s->length;
+      memcpy(solution, s->path, sizeof(Key) * length);
+      break;
+    }
+    if (s->stopped || s->next_bound == INT_MAX) break;
+    s->bound = s->next_bound;
+  }
+
+  if (stats) {
+    stats->nodes = s->nodes;
+    stats->seconds = monotonic_seconds() - start;
+    stats->tt = s->tt_stats;
+  }
+  free(s);
+  return length;
+}
+
+// solution of p from cfg->cache, checked by playing it on a copy of p.
+// returns its length, SOLVER_FAILED if there is none (or it is wrong).
+static int solver_cache_lookup(const struct puzzle* p, Key* solution, const struct solver_config* cfg, struct solver_stats* stats) {
+  if (cfg->cache == NULL) return SOLVER_FAILED;
+  double start = monotonic_seconds();
+  int length = solution_cache_lookup(cfg->cache, p->tiles, p->order, puzzle_hash(p), solution);
+  if (length < 0 || length >= SOLVER_MAX_DEPTH) return SOLVER_FAILED;
+  struct puzzle q = *p;
+  for (int i = 0; i < length; i++) {
+    if (!puzzle_move(&q, solution[i])) return SOLVER_FAILED;
+  }
+  if (!puzzle_is_goal(&q)) return SOLVER_FAILED;
+  if (stats) *stats = (struct solver_stats) { .seconds = monotonic_seconds() - start };
+  return length;
+}
+
+// finds an optimal solution of p. moves are written to solution, which must
+// hold SOLVER_MAX_DEPTH keys. returns length of the solution or SOLVER_FAILED.
+int ida_star(const struct puzzle* p, Key* solution, const struct solver_config* cfg, struct solver_stats* stats) {
+  int length = solver_cache_lookup(p, solution, cfg, stats);
+  if (length != SOLVER_FAILED) return length;
+  length = ida_search(p, NULL, SOLVER_MAX_DEPTH - 1, solution, cfg, stats);
+  if (length != SOLVER_FAILED && cfg->cache) solution_cache_store(cfg->cache, p->tiles, p->order, puzzle_hash(p), solution, length);
+  return length;
+}
+
+// a subproblem produced by expanding the top levels of the search tree.
+struct frontier_node {
+  struct puzzle p;
+  uint8_t depth;
+  Key path[FRONTIER_MAX_DEPTH]; // moves leading from the root to p
+};
+
+// queue of frontier indices owned by a thread. the owner pops from the
+// bottom while other threads steal from the top.
+struct work_deque {
+  pthread_mutex_t lock;
+  int* items;
+  int top, bottom;
+};
+
+struct parallel_search {
+  const struct solver_config* cfg;
+  struct frontier_node* frontier;
+  struct work_deque* deques;
+  int threads;
+  int bound; // f-bound of the running iteration, shared by all threads
+  atomic_int next_bound;
+  atomic_bool found;
+  atomic_bool stopped; // node limit reached or cancelled
+  atomic_bool done; // tells workers to exit
+  atomic_uint_fast64_t nodes;
+  uint16_t tt_generation; // shared by the workers, they are one search
+  pthread_barrier_t start, finish; // iteration boundaries
+  pthread_mutex_t result_lock;
+  int length;
+  Key* solution;
+};
+
+struct ida_worker {
+  struct parallel_search* ps;
+  int id;
+  struct tt_stats tt_stats;
+};
+
+static int deque_pop(struct work_deque* dq) {
+  int item = -1;
+  pthread_mutex_lock(&dq->lock);
+  if (dq->bottom > dq->top) item = dq->items[--dq->bottom];
+  pthread_mutex_unlock(&dq->lock);
+  return item;
+}
+
+static int deque_steal(struct work_deque* dq) {
+  int item = -1;
+  pthread_mutex_lock(&dq->lock);
+  if (dq->bottom > dq->top) item = dq->items[dq->top++];
+  pthread_mutex_unlock(&dq->lock);
+  return item;
+}
+
+// returns the next subproblem for worker id, stealing if its own deque is empty.
+static int next_task(struct parallel_search* ps, int id) {
+  int task = deque_pop(&ps->deques[id]);
+  for (int i = 1; task < 0 && i < ps->threads; i++) {
+    task = deque_steal(&ps->deques[(id + i) % ps->threads]);
+  }
+  return task;
+}
+
+static void atomic_min(atomic_int* dest, int val) {
+  int cur = atomic_load(dest);
+  while (val < cur && !atomic_compare_exchange_weak(dest, &cur, val));
+}
+
+static void* ida_worker_run(void* arg) {
+  struct ida_worker* w = arg;
+  struct parallel_search* ps = w->ps;
+  struct search* s = malloc(sizeof(struct search));
+
+  while (true) {
+    pthread_barrier_wait(&ps->start);
+    if (atomic_load(&ps->done)) break;
+
+    int task;
+    while (s && !atomic_load(&ps->found) && !atomic_load(&ps->stopped) && (task = next_task(ps, w->id)) >= 0) {
+      struct frontier_node* node = &ps->frontier[task];
+      search_init(s, &node->p, NULL, ps->cfg);
+      s->tt_generation = ps->tt_generation;
+      s->found = &ps->found;
+      s->bound = ps->bound;
+      s->next_bound = INT_MAX;
+      if (ps->cfg->node_limit) {
+        uint64_t used = atomic_load(&ps->nodes);
+        s->node_limit = (used < ps->cfg->node_limit) ? ps->cfg->node_limit - used : 1;
+      }
+
+      bool solved = ida_dfs(s, node->depth, node->path[node->depth - 1]);
+      atomic_fetch_add(&ps->nodes, s->nodes);
+      tt_stats_merge(&w->tt_stats, &s->tt_stats);
+      if (solved) {
+        pthread_mutex_lock(&ps->result_lock);
+        if (!atomic_load(&ps->found)) {
+          memcpy(ps->solution, node->path, sizeof(Key) * node->depth);
+          memcpy(ps->solution + node->depth, s->path + node->depth, sizeof(Key) * (s->length - node->depth));
+          ps->length = s->length;
+          atomic_store(&ps->found, true);
+        }
+        pthread_mutex_unlock(&ps->result_lock);
+      } else if (s->stopped && !atomic_load(&ps->found)) {
+        atomic_store(&ps->stopped, true);
+      } else {
+        atomic_min(&ps->next_bound, s->next_bound);
+      }
+    }
+    if (s == NULL) atomic_store(&ps->stopped, true);
+    pthread_barrier_wait(&ps->finish);
+  }
+  free(s);
+  return NULL;
+}
+
+// expands p breadth-first until there are at least `wanted` subproblems.
+// returns the number of nodes written to *frontier, or 0 if a solution
+// was met on the way (in which case it is copied into solution).
+static int expand_frontier(const struct puzzle* p, int wanted, struct frontier_node** frontier, Key* solution, int* length) {
+  int cap = wanted * 4, count = 1;
+  struct frontier_node* level = malloc(sizeof(struct frontier_node) * cap);
+  struct frontier_node* next = malloc(sizeof(struct frontier_node) * cap);
+  level[0] = (struct frontier_node) { .p = *p, .depth = 0 };
+
+  for (int depth = 0; count < wanted && depth < FRONTIER_MAX_DEPTH; depth++) {
+    int next_count = 0;
+    for (int i = 0; i < count; i++) {
+      if (puzzle_is_goal(&level[i].p)) {
+        memcpy(solution, level[i].path, sizeof(Key) * depth);
+        *length = depth;
+        free(level);
+        free(next);
+        return 0;
+      }
+      for (int m = 0; m < 4; m++) {
+        Key key = solver_moves[m];
+        if (depth > 0 && key == -level[i].path[depth - 1]) continue;
+        struct frontier_node child = level[i];
+        if (!puzzle_move(&child.p, key)) continue;
+        child.path[child.depth++] = key;
+        if (next_count == cap) {
+          cap *= 2;
+          next = realloc(next, sizeof(struct frontier_node) * cap);
+          level = realloc(level, sizeof(struct frontier_node) * cap);
+        }
+        next[next_count++] = child;
+      }
+    }
+    struct frontier_node* tmp = level;
+    level = next;
+    next = tmp;
+    count = next_count;
+  }
+  free(next);
+  *frontier = level;
+  return count;
+}
+
+// same as ida_star(), using cfg->threads threads.
+int parallel_ida_star(const struct puzzle* p, Key* solution, const struct solver_config* cfg, struct solver_stats* stats) {
+  if (cfg->threads <= 1) return ida_star(p, solution, cfg, stats);
+  int cached = solver_cache_lookup(p, solution, cfg, stats);
+  if (cached != SOLVER_FAILED) return cached;
+
+  double start = monotonic_seconds();
+  struct parallel_search ps = {
+    .cfg = cfg,
+    .threads = cfg->threads,
+    .length = SOLVER_FAILED,
+    .solution = solution,
+  };
+  int length = SOLVER_FAILED;
+  int count = expand_frontier(p, cfg->threads * FRONTIER_PER_THREAD, &ps.frontier, solution, &length);
+  if (count == 0) {
+    if (stats) *stats = (struct solver_stats) { .seconds = monotonic_seconds() - start };
+    return length;
+  }
+
+  ps.deques = malloc(sizeof(struct work_deque) * ps.threads);
+  for (int i = 0; i < ps.threads; i++) {
+    pthread_mutex_init(&ps.deques[i].lock, NULL);
+    ps.deques[i].items = malloc(sizeof(int) * count);
+  }
+  pthread_mutex_init(&ps.result_lock, NULL);
+  if (cfg->tt) ps.tt_generation = tt_new_search(cfg->tt);
+  pthread_barrier_init(&ps.start, NULL, ps.threads + 1);
+  pthread_barrier_init(&ps.finish, NULL, ps.threads + 1);
+
+  pthread_t tids[ps.threads];
+  struct ida_worker workers[ps.threads];
+  for (int i = 0; i < ps.threads; i++) {
+    workers[i] = (struct ida_worker) { .ps = &ps, .id = i, .tt_stats = { 0 } };
+    pthread_create(&tids[i], NULL, ida_worker_run, &workers[i]);
+  }
+
+  struct search* root = malloc(sizeof(struct search));
+  search_init(root, p, NULL, cfg);
+  ps.bound = search_h(root);
+  free(root);
+
+  while (ps.bound < SOLVER_MAX_DEPTH) {
+    // deal the subproblems round-robin, workers rebalance by stealing.
+    for (int i = 0; i < ps.threads; i++) ps.deques[i].top = ps.deques[i].bottom = 0;
+    for (int i = 0; i < count; i++) {
+      struct work_deque* dq = &ps.deques[i % ps.threads];
+      dq->items[dq->bottom++] = i;
+    }
+    atomic_store(&ps.next_bound, INT_MAX);
+
+    pthread_barrier_wait(&ps.start);
+    pthread_barrier_wait(&ps.finish);
+
+    if (atomic_load(&ps.found)) {
+      length = ps.length;
+      break;
+    }
+    if (atomic_load(&ps.stopped) || atomic_load(&ps.next_bound) == INT_MAX) break;
+    ps.bound = atomic_load(&ps.next_bound);
+  }
+
+  atomic_store(&ps.done, true);
+  pthread_barrier_wait(&ps.start);
+  struct tt_stats tt_stats = { 0 };
+  for (int i = 0; i < ps.threads; i++) {
+    pthread_join(tids[i], NULL);
+    tt_stats_merge(&tt_stats, &workers[i].tt_stats);
+    pthread_mutex_destroy(&ps.deques[i].lock);
+    free(ps.deques[i].items);
+  }
+  pthread_barrier_destroy(&ps.start);
+  pthread_barrier_destroy(&ps.finish);
+  pthread_mutex_destroy(&ps.result_lock);
+  free(ps.deques);
+  free(ps.frontier);
+
+  if (stats) {
+    stats->nodes = atomic_load(&ps.nodes);
+    stats->seconds = monotonic_seconds() - start;
+    stats->tt = tt_stats;
+  }
+  if (length != SOLVER_FAILED && cfg->cache) solution_cache_store(cfg->cache, p->tiles, p->order, puzzle_hash(p), solution, length);
+  return length;
+}
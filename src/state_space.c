@@ -0,0 +1,326 @@
+/*
+Exhaustive state space analysis of small boards.
+
+Every arrangement of a board with n cells is a permutation of 0..n-1 and
+gets a unique index (its rank) from the Lehmer code, so the whole state
+space of a 3x3 board fits in one flat array of 9! entries. Every entry
+only takes 2 bits:
+
+  - 3 : not reached (yet)
+  - d % 3 : reached at distance d from the solved board
+
+A breadth-first search fills the array one level at a time. Neighbours of
+a state are exactly one move closer or further away, so the distance mod
+3 is enough to tell the levels apart and to walk any state back to the
+goal, which gives its exact distance (ss_distance()). Each level is split
+into slices of ranks that are expanded by a pool of threads.
+
+The finished array is 90 KB for 3x3 and cached in DISTANCE_TABLE_FILE.
+It is used to deal 3x3 games of an exact optimal distance (see generator.c).
+*/
+
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "../lib/uni-void.c"
+#include "solver.c"
+
+// largest board that is searched exhaustively.
+#define SS_MAX_CELLS 9
+
+#define SS_UNSEEN 3
+#define SS_MAGIC 0x31535355 // "USS1"
+
+// deepest level the search keeps a count for.
+#define SS_MAX_DISTANCE 64
+
+struct state_space {
+  int order;
+  uint64_t states; // n! entries, half of them reachable
+  _Atomic uint8_t* cells; // 4 states a byte
+  int max_distance;
+  uint64_t level_count[SS_MAX_DISTANCE]; // states at every distance
+};
+
+// lehmer code of the permutation held in tiles.
+uint64_t ss_rank(const uint8_t* tiles, int n) {
+  uint64_t rank = 0;
+  for (int i = 0; i < n; i++) {
+    int smaller = 0;
+    for (int j = i + 1; j < n; j++) smaller += tiles[j] < tiles[i];
+    rank = rank * (n - i) + smaller;
+  }
+  return rank;
+}
+
+// inverse of ss_rank().
+void ss_unrank(uint64_t rank, uint8_t* tiles, int n) {
+  int digits[SS_MAX_CELLS];
+  bool used[SS_MAX_CELLS] = { 0 };
+  for (int i = n - 1; i >= 0; i--) {
+    digits[i] = rank % (n - i);
+    rank /= n - i;
+  }
+  // every digit picks the k-th smallest value not used yet.
+  for (int i = 0; i < n; i++) {
+    int v = 0;
+    for (int k = digits[i]; used[v] || k > 0; v++) {
+      if (!used[v]) k--;
+    }
+    used[v] = true;
+    tiles[i] = v;
+  }
+}
+
+static inline int ss_get(const struct state_space* ss, uint64_t rank) {
+  return (atomic_load_explicit(&ss->cells[rank >> 2], memory_order_relaxed) >> ((rank & 3) * 2)) & 3;
+}
+
+// marks an unseen state with val. returns false if it was already marked.
+static inline bool ss_mark(struct state_space* ss, uint64_t rank, int val) {
+  int shift = (rank & 3) * 2;
+  uint8_t old = atomic_fetch_and_explicit(&ss->cells[rank >> 2], ~((SS_UNSEEN ^ val) << shift), memory_order_relaxed);
+  return ((old >> shift) & 3) == SS_UNSEEN;
+}
+
+static void ss_to_puzzle(const struct state_space* ss, uint64_t rank, struct puzzle* p) {
+  p->order = ss->order;
+  ss_unrank(rank, p->tiles, ss->order * ss->order);
+  for (int i = 0; i < ss->order * ss->order; i++) {
+    if (p->tiles[i] == 0) p->zero = i;
+  }
+}
+
+// a slice of the ranks, expanded by one thread.
+struct ss_worker {
+  pthread_t thread;
+  struct state_space* ss;
+  uint64_t begin, end;
+  int depth;
+  uint64_t found; // states reached at depth + 1
+};
+
+static void* ss_worker_run(void* arg) {
+  struct ss_worker* w = arg;
+  struct state_space* ss = w->ss;
+  int size = ss->order * ss->order, val = w->depth % 3, next = (w->depth + 1) % 3;
+  struct puzzle p;
+
+  w->found = 0;
+  for (uint64_t rank = w->begin; rank < w->end; rank++) {
+    // states of depth - 3, depth - 6, ... carry the same value, but all their
+    // neighbours are already marked, so expanding them again is harmless.
+    if (ss_get(ss, rank) != val) continue;
+    ss_to_puzzle(ss, rank, &p);
+    for (int m = 0; m < 4; m++) {
+      int target = puzzle_move_target(ss->order, p.zero, solver_moves[m]);
+      if (target < 0) continue;
+      p.tiles[p.zero] = p.tiles[target];
+      p.tiles[target] = 0;
+      uint64_t neighbour = ss_rank(p.tiles, size);
+      p.tiles[target] = p.tiles[p.zero];
+      p.tiles[p.zero] = 0;
+      if (ss_get(ss, neighbour) == SS_UNSEEN && ss_mark(ss, neighbour, next)) w->found++;
+    }
+  }
+  return NULL;
+}
+
+void ss_free(struct state_space* ss) {
+  free((void*)ss->cells);
+  ss->cells = NULL;
+}
+
+static bool ss_alloc(struct state_space* ss, int order) {
+  int n = order * order;
+  if (order < 2 || n > SS_MAX_CELLS) return false;
+  *ss = (struct state_space) { .order = order, .states = 1 };
+  for (int i = 2; i <= n; i++) ss->states *= i;
+  ss->cells = malloc((ss->states + 3) / 4);
+  if (ss->cells == NULL) return false;
+  memset((void*)ss->cells, 0xff, (ss->states + 3) / 4);
+  return true;
+}
+
+// fills ss with the distance of every state of a board of given order,
+// using the given number of threads. returns false if order is too large.
+bool ss_generate(struct state_space* ss, int order, int threads) {
+  if (!ss_alloc(ss, order)) return false;
+  if (threads < 1) threads = 1;
+  struct ss_worker workers[threads];
+  struct puzzle goal;
+  puzzle_goal(&goal, order);
+  ss_mark(ss, ss_rank(goal.tiles, order * order), 0);
+  ss->level_count[0] = 1;
+
+  for (int depth = 0; depth + 1 < SS_MAX_DISTANCE; depth++) {
+    uint64_t found = 0;
+    for (int t = 0; t < threads; t++) {
+      workers[t] = (struct ss_worker) {
+        .ss = ss,
+        .begin = ss->states * t / threads,
+        .end = ss->states * (t + 1) / threads,
+        .depth = depth,
+      };
+      pthread_create(&workers[t].thread, NULL, ss_worker_run, &workers[t]);
+    }
+    for (int t = 0; t < threads; t++) {
+      pthread_join(workers[t].thread, NULL);
+      found += workers[t].found;
+    }
+    if (found == 0) break;
+    ss->level_count[depth + 1] = found;
+    ss->max_distance = depth + 1;
+  }
+  return true;
+}
+
+bool ss_save(const struct state_space* ss, const char* filename) {
+  FILE* fp = fopen(filename, "wb");
+  if (fp == NULL) return false;
+  uint32_t header[2] = { SS_MAGIC, ss->order };
+  bool ok = fwrite(header, sizeof(header), 1, fp) == 1 &&
+            fwrite(&ss->max_distance, sizeof(int), 1, fp) == 1 &&
+            fwrite(ss->level_count, sizeof(ss->level_count), 1, fp) == 1 &&
+            fwrite((void*)ss->cells, (ss->states + 3) / 4, 1, fp) == 1;
+  fclose(fp);
+  return ok;
+}
+
+bool ss_load(struct state_space* ss, int order, const char* filename) {
+  ss->cells = NULL;
+  FILE* fp = fopen(filename, "rb");
+  if (fp == NULL) return false;
+  uint32_t header[2];
+  bool ok = fread(header, sizeof(header), 1, fp) == 1 && header[0] == SS_MAGIC && header[1] == (uint32_t)order &&
+            ss_alloc(ss, order) &&
+            fread(&ss->max_distance, sizeof(int), 1, fp) == 1 &&
+            ss->max_distance >= 0 && ss->max_distance < SS_MAX_DISTANCE && // indexes level_count
+            fread(ss->level_count, sizeof(ss->level_count), 1, fp) == 1 &&
+            fread((void*)ss->cells, (ss->states + 3) / 4, 1, fp) == 1;
+  fclose(fp);
+  // half of all permutations are reachable, a file that doesn't add up to
+  // that wasn't written by ss_save().
+  uint64_t reachable = 0;
+  for (int d = 0; ok && d <= ss->max_distance; d++) reachable += ss->level_count[d];
+  ok = ok && reachable == ss->states / 2;
+  if (!ok) ss_free(ss);
+  return ok;
+}
+
+// exact optimal distance of p, -1 if it can't be reached. p must be of ss->order.
+int ss_distance(const struct state_space* ss, const struct puzzle* p) {
+  int size = ss->order * ss->order, distance = 0;
+  struct puzzle cur = *p;
+  uint64_t rank = ss_rank(cur.tiles, size);
+  int val = ss_get(ss, rank);
+  if (val == SS_UNSEEN) return -1;
+
+  // some neighbour is always one step closer, until the goal is reached.
+  while (!puzzle_is_goal(&cur)) {
+    int closer = (val + 2) % 3;
+    for (int m = 0; m < 4; m++) {
+      if (!puzzle_move(&cur, solver_moves[m])) continue;
+      if (ss_get(ss, ss_rank(cur.tiles, size)) == closer) break;
+      puzzle_move(&cur, -solver_moves[m]);
+    }
+    val = closer;
+    distance++;
+  }
+  return distance;
+}
+
+static struct state_space distance_table;
+static pthread_once_t distance_table_once = PTHREAD_ONCE_INIT;
+
+static void distance_table_init() {
+  if (ss_load(&distance_table, 3, DISTANCE_TABLE_FILE)) return;
+  if (ss_generate(&distance_table, 3, sysconf(_SC_NPROCESSORS_ONLN))) {
+    ss_save(&distance_table, DISTANCE_TABLE_FILE);
+  }
+}
+
+// the 3x3 distance table, loaded or generated on first use. NULL on failure.
+const struct state_space* distance_table_get() {
+  pthread_once(&distance_table_once, distance_table_init);
+  return distance_table.cells ? &distance_table : NULL;
+}
+
+// ranks of every board in the distance table, nearest first. the boards at
+// distance d are the level_count[d] ranks after those of all nearer levels.
+// built once by walking out from the goal: the table tells which neighbours
+// are one step further away, a bitmap keeps them from being queued twice.
+static uint32_t* distance_ranks;
+static pthread_once_t distance_ranks_once = PTHREAD_ONCE_INIT;
+
+static void distance_ranks_init() {
+  const struct state_space* ss = distance_table_get();
+  if (ss == NULL) return;
+  int size = ss->order * ss->order;
+  uint64_t reachable = 0;
+  for (int d = 0; d <= ss->max_distance; d++) reachable += ss->level_count[d];
+  uint32_t* ranks = malloc(sizeof(uint32_t) * reachable);
+  uint8_t* queued = calloc((ss->states + 7) / 8, 1);
+  if (ranks == NULL || queued == NULL) {
+    free(ranks);
+    free(queued);
+    return;
+  }
+  struct puzzle p;
+  puzzle_goal(&p, ss->order);
+  ranks[0] = ss_rank(p.tiles, size);
+  queued[ranks[0] >> 3] |= 1 << (ranks[0] & 7);
+  uint64_t head = 0, tail = 1;
+  while (head < tail) {
+    uint32_t rank = ranks[head++];
+    int further = (ss_get(ss, rank) + 1) % 3;
+    ss_to_puzzle(ss, rank, &p);
+    for (int m = 0; m < 4; m++) {
+      if (!puzzle_move(&p, solver_moves[m])) continue;
+      uint32_t next = ss_rank(p.tiles, size);
+      if (ss_get(ss, next) == further && !(queued[next >> 3] & (1 << (next & 7))) && tail < reachable) {
+        queued[next >> 3] |= 1 << (next & 7);
+        ranks[tail++] = next;
+      }
+      puzzle_move(&p, -solver_moves[m]);
+    }
+  }
+  free(queued);
+  if (tail == reachable) distance_ranks = ranks;
+  else free(ranks); // the table doesn't add up
+}
+
+// fills p with a 3x3 board drawn uniformly from all the boards whose
+// optimal solution is min to max moves long. returns false if there are none.
+bool puzzle_from_table(struct puzzle* p, int min, int max) {
+  pthread_once(&distance_ranks_once, distance_ranks_init);
+  const struct state_space* ss = distance_table_get();
+  if (ss == NULL || distance_ranks == NULL) return false;
+  if (min < 0) min = 0;
+  if (max > ss->max_distance) max = ss->max_distance;
+  uint64_t first = 0, total = 0;
+  for (int d = 0; d < min; d++) first += ss->level_count[d];
+  for (int d = min; d <= max; d++) total += ss->level_count[d];
+  if (total == 0) return false;
+  uint64_t pick = ((uint64_t)rand() * RAND_MAX + rand()) % total;
+  ss_to_puzzle(ss, distance_ranks[first + pick], p);
+  return true;
+}
+
+// tries to fill p with a random board of given order whose optimal solution
+// is exactly distance moves long. 3x3 boards are drawn uniformly from the
+// distance table. larger boards are random walks checked by the solver.
+// returns false if no such board turned up within a bounded number of tries.
+bool puzzle_at_distance(struct puzzle* p, int order, int distance) {
+  if (order == 3) return puzzle_from_table(p, distance, distance);
+
+  if (distance <= 0 || order < 2 || order > SOLVER_MAX_ORDER) return false;
+  Key path[SOLVER_MAX_DEPTH];
+  struct solver_config cfg = { .heuristic = heur_walking_distance, .node_limit = 2000000 };
+  for (int attempt = 0; attempt < 64; attempt++) {
+    puzzle_scramble(p, order, distance + rand() % (distance + 1));
+    if (ida_star(p, path, &cfg, NULL) == distance) return true;
+  }
+  return false;
+}
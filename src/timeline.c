@@ -0,0 +1,130 @@
+/*
+Timeline of a game: the board after any step of it, without replaying
+the whole game or keeping every board.
+
+The moves themselves are already in the replay of the game (replay.c),
+including the ones undo and redo made. The timeline only adds a
+checkpoint (a copy of the board) every `interval` steps. Looking at step
+n copies the checkpoint before it and replays at most `interval` moves
+from there.
+
+The interval starts at TIMELINE_MIN_INTERVAL and doubles whenever there
+are more checkpoints than steps between them, dropping every other
+checkpoint. So after n steps there are about sqrt(n) checkpoints, about
+sqrt(n) steps apart: a seek costs O(sqrt(n)) moves and the checkpoints
+take O(sqrt(n) * order^2) memory. A 16x16 game of a million steps keeps
+about 1000 boards, 512 KB.
+*/
+
+#pragma once
+
+#include "libunivoid.h"
+#include "replay.c"
+
+#define TIMELINE_MIN_INTERVAL 16
+
+// moves the void of a flat board of given order. returns false at an edge.
+static bool timeline_move(uint16_t* tiles, int order, int* zero, Key key) {
+  int x = *zero / order, y = *zero % order;
+  switch (key) {
+    case key_up : if (x == 0) return false; x--; break;
+    case key_down : if (x == order - 1) return false; x++; break;
+    case key_left : if (y == 0) return false; y--; break;
+    case key_right : if (y == order - 1) return false; y++; break;
+    default : return false;
+  }
+  int target = x * order + y;
+  tiles[*zero] = tiles[target];
+  tiles[target] = 0;
+  *zero = target;
+  return true;
+}
+
+static uint16_t* timeline_board(const struct timeline* tl, uint32_t i) {
+  return tl->boards + (size_t)i * tl->order * tl->order;
+}
+
+// adds board as the checkpoint of step count * interval.
+static bool timeline_push(struct timeline* tl, const uint16_t* board) {
+  size_t size = tl->order * tl->order;
+  if (tl->count == tl->capacity) {
+    uint32_t capacity = (tl->capacity == 0) ? 16 : tl->capacity * 2;
+    uint16_t* boards = realloc(tl->boards, sizeof(uint16_t) * size * capacity);
+    if (boards == NULL) return false;
+    tl->boards = boards;
+    tl->capacity = capacity;
+  }
+  memcpy(timeline_board(tl, tl->count++), board, sizeof(uint16_t) * size);
+
+  // more checkpoints than steps between them, every other one goes.
+  if (tl->count > tl->interval) {
+    for (uint32_t i = 1; 2 * i < tl->count; i++) {
+      memcpy(timeline_board(tl, i), timeline_board(tl, 2 * i), sizeof(uint16_t) * size);
+    }
+    tl->count = (tl->count + 1) / 2;
+    tl->interval *= 2;
+  }
+  return true;
+}
+
+// records the checkpoints due for the steps just recorded into r, the
+// board after them is in gs. a slide records several steps at once and
+// may pass a checkpoint, whose board is found by taking back the steps
+// after it.
+void timeline_record(struct timeline* tl, const struct replay* r, const struct game_state* gs) {
+  while (tl->order != 0 && (uint64_t)tl->count * tl->interval <= r->length) {
+    int order = tl->order, zero = gs->curs_x * order + gs->curs_y;
+    uint16_t board[order * order];
+    for (int i = 0; i < order; i++) {
+      for (int j = 0; j < order; j++) board[i * order + j] = gs->mat[i][j];
+    }
+    for (uint32_t i = r->length; i > tl->count * tl->interval; i--) timeline_move(board, order, &zero, -replay_move(r, i - 1));
+    if (!timeline_push(tl, board)) tl->order = 0; // out of memory, no timeline then
+  }
+}
+
+// builds the timeline of the game in gs, whose steps so far are in r. the
+// board at step 0 is found by taking back every step. returns false if the
+// game has no replay to build it from.
+bool timeline_init(struct timeline* tl, const struct replay* r, const struct game_state* gs) {
+  *tl = (struct timeline) { .interval = TIMELINE_MIN_INTERVAL };
+  if (r->order == 0 || r->order != gs->order) return false;
+  int order = gs->order, zero = gs->curs_x * order + gs->curs_y;
+  uint16_t board[order * order];
+  for (int i = 0; i < order; i++) {
+    for (int j = 0; j < order; j++) board[i * order + j] = gs->mat[i][j];
+  }
+  for (uint32_t i = r->length; i > 0; i--) timeline_move(board, order, &zero, -replay_move(r, i - 1));
+
+  tl->order = order;
+  if (!timeline_push(tl, board)) return false;
+  for (uint32_t i = 0; i < r->length; i++) {
+    timeline_move(board, order, &zero, replay_move(r, i));
+    if ((i + 1) % tl->interval == 0 && !timeline_push(tl, board)) return false;
+  }
+  return true;
+}
+
+// puts the board at given step into gs, which must be of the same order.
+// steps past the end of r give the latest board.
+void timeline_seek(const struct timeline* tl, const struct replay* r, uint32_t step, struct game_state* gs) {
+  int order = tl->order, zero = 0;
+  if (step > r->length) step = r->length;
+  uint32_t checkpoint = step / tl->interval;
+  if (checkpoint >= tl->count) checkpoint = tl->count - 1;
+  uint16_t board[order * order];
+  memcpy(board, timeline_board(tl, checkpoint), sizeof(board));
+  while (board[zero] != 0) zero++;
+  for (uint32_t i = checkpoint * tl->interval; i < step; i++) timeline_move(board, order, &zero, replay_move(r, i));
+
+  for (int i = 0; i < order; i++) {
+    for (int j = 0; j < order; j++) gs->mat[i][j] = board[i * order + j];
+  }
+  gs->curs_x = zero / order;
+  gs->curs_y = zero % order;
+}
+
+void timeline_free(struct timeline* tl) {
+  free(tl->boards);
+  *tl = (struct timeline) { .interval = TIMELINE_MIN_INTERVAL };
+}
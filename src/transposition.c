@@ -0,0 +1,162 @@
+/*
+A fixed-size transposition table shared by the solvers.
+
+The table is an array of 64 byte buckets (one cache line) holding four
+entries each, so a probe touches a single line. Entries are written
+without locks: every entry stores its data and the key xor'ed with that
+data. A reader only accepts an entry when both halves agree, so an entry
+torn by two threads writing at once simply reads as a miss.
+
+What the 64-bit data means is up to the caller. tt_pack() and friends
+give the layout used by ida_star(): the f-bound of the iteration that
+stored the entry, the depth the state was reached at, the search that
+stored it, and a priority used to pick which entry of a full bucket gets
+replaced.
+
+An entry only says something about the search that stored it: another
+board (or another goal) reaching the same state at the same bound has
+explored nothing below it yet. So every search takes a generation of its
+own with tt_new_search() and ignores entries of other generations, which
+are also the first to be replaced.
+
+The size is fixed at tt_init() from a memory budget in megabytes.
+*/
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TT_BUCKET_ENTRIES 4
+
+struct tt_entry {
+  _Atomic uint64_t check; // key ^ data
+  _Atomic uint64_t data;
+};
+
+struct tt_bucket {
+  _Alignas(64) struct tt_entry entries[TT_BUCKET_ENTRIES];
+};
+
+struct transposition_table {
+  struct tt_bucket* buckets;
+  uint64_t mask; // bucket count - 1
+  _Atomic uint32_t generation; // of the last search started, see tt_new_search()
+};
+
+// probe statistics. kept by each searcher and merged at the end.
+struct tt_stats {
+  uint64_t probes;
+  uint64_t hits;
+  uint64_t stores;
+};
+
+// data layout used by the IDA* searches. the lowest bit is always set, so
+// data is never 0, which marks an empty entry.
+static inline uint64_t tt_pack(uint16_t bound, uint16_t g, uint16_t generation, uint16_t priority) {
+  return (uint64_t)bound << 48 | (uint64_t)g << 32 | (uint64_t)generation << 16 | (uint64_t)(priority & 0x7fff) << 1 | 1;
+}
+static inline uint16_t tt_bound(uint64_t data) { return data >> 48; }
+static inline uint16_t tt_g(uint64_t data) { return data >> 32; }
+static inline uint16_t tt_generation(uint64_t data) { return data >> 16; }
+static inline uint16_t tt_priority(uint64_t data) { return (data >> 1) & 0x7fff; }
+
+// allocates the largest power of two number of buckets that fits in the
+// budget. returns false if the memory couldn't be allocated.
+bool tt_init(struct transposition_table* tt, size_t megabytes) {
+  size_t budget = megabytes << 20, buckets = 1;
+  while (buckets * 2 * sizeof(struct tt_bucket) <= budget) buckets *= 2;
+
+  tt->buckets = aligned_alloc(64, buckets * sizeof(struct tt_bucket));
+  if (tt->buckets == NULL) return false;
+  memset(tt->buckets, 0, buckets * sizeof(struct tt_bucket));
+  tt->mask = buckets - 1;
+  atomic_init(&tt->generation, 0);
+  return true;
+}
+
+// generation of a new search, never 0. generations are 16 bits in an
+// entry, when they wrap the table is cleared so that an entry from 65536
+// searches ago can't pass for a fresh one. a search still running on it
+// then only sees misses.
+uint16_t tt_new_search(struct transposition_table* tt) {
+  uint32_t generation = atomic_fetch_add(&tt->generation, 1) + 1;
+  if ((generation & 0xffff) == 0) {
+    for (uint64_t b = 0; b <= tt->mask; b++) {
+      for (int i = 0; i < TT_BUCKET_ENTRIES; i++) atomic_store_explicit(&tt->buckets[b].entries[i].data, 0, memory_order_relaxed);
+    }
+    generation = atomic_fetch_add(&tt->generation, 1) + 1;
+  }
+  return generation;
+}
+
+void tt_free(struct transposition_table* tt) {
+  free(tt->buckets);
+  tt->buckets = NULL;
+  tt->mask = 0;
+}
+
+size_t tt_bytes(const struct transposition_table* tt) {
+  return (tt->mask + 1) * sizeof(struct tt_bucket);
+}
+
+// looks key up among the entries of search generation. on a hit the
+// stored data is written to *data.
+bool tt_probe(struct transposition_table* tt, uint64_t key, uint16_t generation, uint64_t* data, struct tt_stats* stats) {
+  struct tt_bucket* bucket = &tt->buckets[key & tt->mask];
+  if (stats) stats->probes++;
+  for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+    uint64_t d = atomic_load_explicit(&bucket->entries[i].data, memory_order_relaxed);
+    uint64_t c = atomic_load_explicit(&bucket->entries[i].check, memory_order_relaxed);
+    if (d != 0 && (c ^ d) == key && tt_generation(d) == generation) {
+      *data = d;
+      if (stats) stats->hits++;
+      return true;
+    }
+  }
+  return false;
+}
+
+// stores data under key. an existing entry for key is overwritten, else an
+// empty entry is used, else an entry of another search, else the entry
+// with the lowest priority is replaced.
+void tt_store(struct transposition_table* tt, uint64_t key, uint64_t data, struct tt_stats* stats) {
+  struct tt_bucket* bucket = &tt->buckets[key & tt->mask];
+  int victim = 0;
+  uint32_t lowest = UINT32_MAX;
+  for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+    uint64_t d = atomic_load_explicit(&bucket->entries[i].data, memory_order_relaxed);
+    uint64_t c = atomic_load_explicit(&bucket->entries[i].check, memory_order_relaxed);
+    if (d == 0 || (c ^ d) == key) {
+      victim = i;
+      break;
+    }
+    uint32_t priority = (tt_generation(d) == tt_generation(data)) ? tt_priority(d) + 1 : 0;
+    if (priority < lowest) {
+      lowest = priority;
+      victim = i;
+    }
+  }
+  atomic_store_explicit(&bucket->entries[victim].data, data, memory_order_relaxed);
+  atomic_store_explicit(&bucket->entries[victim].check, key ^ data, memory_order_relaxed);
+  if (stats) stats->stores++;
+}
+
+// fraction of entries in use.
+double tt_occupancy(const struct transposition_table* tt) {
+  uint64_t used = 0, total = (tt->mask + 1) * TT_BUCKET_ENTRIES;
+  for (uint64_t b = 0; b <= tt->mask; b++) {
+    for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+      if (atomic_load_explicit(&tt->buckets[b].entries[i].data, memory_order_relaxed) != 0) used++;
+    }
+  }
+  return (double)used / total;
+}
+
+void tt_stats_merge(struct tt_stats* dest, const struct tt_stats* src) {
+  dest->probes += src->probes;
+  dest->hits += src->hits;
+  dest->stores += src->stores;
+}
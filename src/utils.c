@@ -1,7 +1,38 @@
 #pragma once
 
 #include "../lib/uni-void.c"
+#include "../lib/arena.c"
 #include "../lib/strings.c"
+#include "zobrist.c"
+#include "kernels.c"
+
+// initialize game_state data type.
+struct game_state game_state_init(Arena* arena, int order) {
+  struct game_state gs = {
+    .order = order,
+    .mode = order - MODE_OFFSET,
+    // since easy mode represents order 3 and index of easy mode
+    // is 1, easy mode = order - 2 (2 is the MODE_OFFSET).
+    .curs_x = -1,
+    .curs_y = -1,
+    .moves = 0,
+    .move_limit = HARD_MODE_MOVE_LIMIT,
+    .count_ctrl = count_stop,
+    .hash = 0,
+    .mat = arena_alloc(arena, sizeof(int*) * order),
+    // rows of the matrix are laid out one after another, so kernels can
+    // index it with a constant stride.
+    .tiles = arena_alloc(arena, sizeof(int) * order * order),
+    .kernel = board_kernel_for(order),
+    // these are stack pointers for undo(utop) and redo(rtop) stacks.
+    .utop = -1,
+    .rtop = -1,
+  };
+  for (int i = 0; i < order; i++) {
+    gs.mat[i] = gs.tiles + i * order;
+  }
+  return gs;
+}
 
 // swaps x and y using xor.
 void swap(int *x, int *y) { *x = *x ^ *y; *y = *x ^ *y; *x = *x ^ *y; }
@@ -25,21 +56,17 @@ Key pop_key(Key stk[], int16_t *top) {
   return stk[(*top)--];
 }
 
-// query the user and return answer as a char*
-// memory should be freed
-char* input_str(const char* query) {
-  char difficulty[50];
-  erase();
-  mvprintw(LINES / 2, CENTER_X(strlen(query)), "%s", query);
-  echo();
-  nocbreak();
-  curs_set(1);
-  refresh();
-  getstr(difficulty);
-  noecho();
-  cbreak();
-  curs_set(0);
-  return strdup(difficulty);
+// puts the stacks back the way they were before an undo (or a redo) of key
+// that couldn't be made. a redo taken from an older branch of the game can
+// run into an edge, more so for a slide.
+void unpop_key(struct game_state* gs, Key action, Key key) {
+  if (action == key_undo) {
+    pop_key(gs->redo_stack, &gs->rtop);
+    push_key(gs->undo_stack, &gs->utop, key);
+  } else if (action == key_redo) {
+    pop_key(gs->undo_stack, &gs->utop);
+    push_key(gs->redo_stack, &gs->rtop, key);
+  }
 }
 
 // creates an array of whole numbers up to specified size and arranges them in random order.
@@ -53,40 +80,6 @@ void make_radomized_array(int* arr, size_t size) {
   }
 }
 
-void display_usage() {
-  const char* help_msg[] = {
-    "left-arrow, h, a : moves cursor to left",
-    "down-arrow, j, s : moves cursor to down",
-    "up-arrow,   k, w : moves cursor to up",
-    "right-arrow,l, d : moves cursor to left",
-    "u                : undo move",
-    "r                : redo move",
-    "qq               : save & exit",
-    "Q                : exit without saving",
-    "Enter            : choose selected item",
-    "?                : shows this window",
-    " ",
-    "  Press any key to close this window",
-  };
-
-  int h = sizeof(help_msg) / sizeof(char*);
-  int w = strlen(help_msg[0]);
-  refresh();
-  WINDOW* usage_win = newwin(h + 2, w + 3, CENTER_Y(h), CENTER_X(w));
-  box(usage_win, 0, 0);
-
-  for (int i = 0; i < h; i++) {
-    mvwprintw(usage_win,i + 1, 1, "%s", help_msg[i]);
-  }
-
-  wrefresh(usage_win);
-  getch();
-  werase(usage_win);
-  wborder(usage_win, ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ');
-  wrefresh(usage_win);
-  delwin(usage_win);
-}
-
 String file_to_str(char* filename) {
   String file = str_declare(STR_DYNAMIC);
   FILE* fp = fopen(filename, "r");
@@ -113,4 +106,142 @@ void str_to_file(char* filename, String content) {
   fclose(fp);
 }
 
+// the key that slides tiles of the void-tile's way in direction dir
+// (key_up etc.) at once. a single tile is just dir.
+Key slide_key(Key dir, int tiles) {
+  if (tiles <= 1) return dir;
+  return (dir > 0) ? (tiles << KEY_SLIDE_SHIFT | dir) : -(tiles << KEY_SLIDE_SHIFT | -dir);
+}
+
+// tiles moved by key, 1 for anything that isn't a slide.
+int key_tiles(Key key) {
+  int tiles = abs(key) >> KEY_SLIDE_SHIFT;
+  return (tiles > 1) ? tiles : 1;
+}
+
+// direction of a slide, other keys are returned as they are.
+Key key_direction(Key key) {
+  if (key_tiles(key) == 1) return key;
+  return (key > 0) ? (key & 3) : -(-key & 3);
+}
+
+// cuts a slide down to the tiles there is room for in its direction and,
+// when moves are counted down, to the moves left. other keys are returned
+// as they are.
+Key slide_clamp(const struct game_state* gs, Key key) {
+  int tiles = key_tiles(key), room;
+  if (tiles == 1) return key;
+  Key dir = key_direction(key);
+  switch (dir) {
+    case key_up : room = gs->curs_x; break;
+    case key_down : room = gs->order - 1 - gs->curs_x; break;
+    case key_left : room = gs->curs_y; break;
+    case key_right : room = gs->order - 1 - gs->curs_y; break;
+    default : return key_invalid;
+  }
+  if (tiles > room) tiles = room;
+  if (gs->count_ctrl == count_down && tiles > gs->moves) tiles = gs->moves;
+  return slide_key(dir, tiles);
+}
+
+// updates moves based on count_ctrl, a slide counts every tile it moved.
+void update_moves(struct game_state* gs, Key key) {
+  if (gs->count_ctrl == count_up) {
+    gs->moves += key_tiles(key);
+  } else if (gs->count_ctrl == count_down){
+    gs->moves -= key_tiles(key);
+  }
+}
+
+// moves made so far, whichever way the counter runs. this is what the
+// leaderboard keeps: the moves left in hard mode depend on the budget of
+// the board, see deal_game(), and can't be compared between boards.
+uint16_t moves_used(const struct game_state* gs) {
+  return (gs->count_ctrl == count_down) ? gs->move_limit - gs->moves : gs->moves;
+}
+
+// true if the tiles are in ascending reading order, wherever the void-tile
+// is. this is what ends a game.
+bool is_sorted(const struct game_state* gs) {
+  return gs->kernel->is_sorted(gs);
+}
+
+// sum of the manhattan distances of all tiles from their goal cells.
+int game_state_manhattan(const struct game_state* gs) {
+  return gs->kernel->manhattan(gs);
+}
+
+// The below function checks solvability of our puzzle.
+// In an even-order puzzle, solvability depends not only on
+// the number of inversions but also on the row position of
+// the empty tile
+// This chat-gpt code. It works as expected.
+bool is_solvable(int* list, int order) {
+    int inversions = 0;
+    int size = order * order;
+    int blank_row = 0; // Row index of blank tile (zero)
+
+    for (int i = 0; i < size; i++) {
+        if (list[i] == 0) {
+            blank_row = i / order;  // Get row position of the blank (zero)
+            continue;
+        }
+        for (int j = i + 1; j < size; j++) {
+            if (list[j] && list[i] > list[j]) {
+                inversions++;
+            }
+        }
+    }
+
+    if (order % 2 != 0) {
+        return (inversions % 2 == 0);
+    }
+    return ((inversions + blank_row) % 2 == 1);
+}
+
+// computes the zobrist hash of the game matrix from scratch.
+uint64_t game_state_hash(const struct game_state* gs) {
+  uint64_t hash = 0;
+  for (int i = 0; i < gs->order; i++) {
+    for (int j = 0; j < gs->order; j++) {
+      hash ^= zobrist_key(gs->mat[i][j], i * gs->order + j);
+    }
+  }
+  return hash;
+}
 
+// This function populate our game matrix with a solvable combination
+// of natural numbers sorted in random order.
+void populate_mat(struct game_state* gs) {
+  int order = gs->order, rand_arr[order * order], pos = 0;
+  do {
+    // below creates an array of whole numbers upto given size limit
+    // and arrange them randomly. Defined in utils.c
+    make_radomized_array(rand_arr, order * order);
+  } while (!is_solvable(rand_arr, order));
+
+  for (int i = 0; i < order; i++) {
+    for (int j = 0; j < order; j++) {
+      if (rand_arr[pos] == 0) { // 0 is our void-tile.
+        gs->curs_x = i; // saves position of zero to start cursor from there.
+        gs->curs_y = j;
+      }
+      gs->mat[i][j] = rand_arr[pos];
+      pos++;
+    }
+  }
+  gs->hash = game_state_hash(gs);
+}
+
+// this function updates position of our 0 (void-tile) based on key input.
+// returns count_stop if the void-tile can't move that way.
+Counter mov_zero(struct game_state* gs, Key key) {
+  return gs->kernel->move(gs, key);
+}
+
+// returns seconds elapsed on the monotonic clock. used for timing solvers and benchmarks.
+double monotonic_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
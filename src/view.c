@@ -0,0 +1,273 @@
+/*
+The ncurses side of the game that isn't the main loop: the board, the
+status line, prompts, the help window and the leaderboard screen.
+Everything here only draws, the game core behind it lives in libunivoid
+(see libunivoid.h).
+*/
+
+#pragma once
+
+#include <ncurses.h>
+#include "libunivoid.h"
+
+// these macros evaluate mid point of stdscr based on given offset
+#define CENTER_Y(offset) (((LINES - (offset)) / 2))
+#define CENTER_X(offset) (((COLS - (offset)) / 2))
+
+// frames are drawn at most this often, keys that come in faster are
+// applied together and drawn once.
+#define FRAME_INTERVAL_MS 16
+
+// most keys applied before a frame is drawn anyway.
+#define INPUT_BATCH 64
+
+struct status_line {
+  size_t moves;
+  char *msg;
+  Key key;
+};
+
+// initialize status line with given message.
+struct status_line status_line_init(char* msg) {
+  return (struct status_line) {
+    .moves = 0,
+    .key = 0,
+    .msg = msg
+  };
+}
+
+// the board is drawn into a pad as big as the whole board, and only the
+// part of it that fits on the screen is copied onto stdscr. the text of
+// every cell, highlight included, is kept in a chtype buffer of the
+// board. a cell is only formatted again when its tile or its highlight
+// changes, and only the rows that changed are written to the pad, one
+// mvwaddchnstr() each. a move costs a row or two however big the board is.
+struct board_view {
+  WINDOW* pad;
+  int order;
+  int cell; // columns of a cell
+  int* shown; // what every cell of the pad shows: tile << 1 | highlighted, -1 for the void
+  chtype* text; // order rows of order * cell characters, as the pad shows them
+  int top, left; // first row and column of the board on screen
+};
+
+static struct board_view board_view;
+
+// sets up the pad for boards of given order.
+static bool board_view_init(struct board_view* v, int order) {
+  if (v->pad != NULL) delwin(v->pad);
+  free(v->shown);
+  free(v->text);
+  *v = (struct board_view) { .order = order, .cell = 4 };
+  for (int n = order * order - 1; n >= 1000; n /= 10) v->cell++; // room for the largest tile
+  v->pad = newpad(order, order * v->cell);
+  v->shown = malloc(sizeof(int) * order * order);
+  v->text = malloc(sizeof(chtype) * order * order * v->cell);
+  if (v->pad == NULL || v->shown == NULL || v->text == NULL) return false;
+  for (int i = 0; i < order * order; i++) v->shown[i] = -2; // nothing drawn yet
+  return true;
+}
+
+// writes the text of a cell into out: the tile right aligned and a space,
+// bold if it is in place. the void-tile is all spaces.
+static void board_view_format(chtype* out, int cell, int shown) {
+  chtype attr = (shown >= 0 && (shown & 1)) ? A_BOLD : A_NORMAL;
+  for (int k = 0; k < cell; k++) out[k] = ' ' | attr;
+  for (int tile = shown >> 1, k = cell - 2; shown >= 0 && tile > 0; tile /= 10, k--) out[k] = ('0' + tile % 10) | attr;
+}
+
+// first row (or column) on screen. it only moves once the void-tile gets
+// within a quarter of the screen from its edge.
+static int board_view_scroll(int first, int curs, int visible, int order) {
+  int margin = visible / 4;
+  if (curs < first + margin) first = curs - margin;
+  if (curs > first + visible - 1 - margin) first = curs - visible + 1 + margin;
+  if (first > order - visible) first = order - visible;
+  return (first > 0) ? first : 0;
+}
+
+// prints the matrix using ncurses. boards larger than the screen are
+// scrolled to keep the void-tile in sight.
+void update_matrix_view(const struct game_state* gs) {
+  struct board_view* v = &board_view;
+  int order = gs->order, count = 0;
+  erase();
+  if (v->order != order && !board_view_init(v, order)) return;
+
+  for (int i = 0; i < order; i++) {
+    chtype* row = v->text + i * order * v->cell;
+    bool changed = false;
+    for (int j = 0; j < order; j++) {
+      int tile = gs->mat[i][j], shown = -1; // void-tile in place of 0
+      if (i != gs->curs_x || j != gs->curs_y) {
+        shown = tile << 1 | (count == tile - 1); // highlighting numbers that are in correct position
+        count++;
+      }
+      if (v->shown[i * order + j] == shown) continue;
+      v->shown[i * order + j] = shown;
+      board_view_format(row + j * v->cell, v->cell, shown);
+      changed = true;
+    }
+    if (changed) mvwaddchnstr(v->pad, i, 0, row, order * v->cell);
+  }
+
+  // the status line and the line above it stay free.
+  int rows = (order < LINES - 2) ? order : LINES - 2;
+  int cols = (order < COLS / v->cell) ? order : COLS / v->cell;
+  if (rows <= 0 || cols <= 0) return;
+  v->top = board_view_scroll(v->top, gs->curs_x, rows, order);
+  v->left = board_view_scroll(v->left, gs->curs_y, cols, order);
+  int y = CENTER_Y(rows), x = CENTER_X(cols * v->cell);
+  copywin(v->pad, stdscr, v->top, v->left * v->cell, y, x, y + rows - 1, x + cols * v->cell - 1, FALSE);
+}
+
+// displays the bottom status line.
+void update_status_line(struct status_line data) {
+  int current_x, current_y;
+  getyx(stdscr, current_x, current_y);
+
+  mvprintw(LINES - 1, 1, " moves: %2zu", data.moves);
+  if (COLS > 30)
+    mvprintw(LINES - 1, CENTER_X(strlen(data.msg) - 8), "%s", data.msg);
+
+  move(LINES - 1, COLS - 2);
+  switch(key_direction(data.key)) {
+    case key_up: printw("U"); break;
+    case key_down: printw("D"); break;
+    case key_left: printw("L"); break;
+    case key_right: printw("R"); break;
+    default: break;
+  }
+  mvchgat(LINES - 1, 0, -1, A_REVERSE, 1, NULL);
+  
+  move(current_x, current_y);
+}
+
+// query the user and return answer as a char*
+// memory should be freed
+char* input_str(const char* query) {
+  char difficulty[50];
+  erase();
+  mvprintw(LINES / 2, CENTER_X(strlen(query)), "%s", query);
+  echo();
+  nocbreak();
+  curs_set(1);
+  refresh();
+  getstr(difficulty);
+  noecho();
+  cbreak();
+  curs_set(0);
+  return strdup(difficulty);
+}
+
+void display_usage() {
+  const char* help_msg[] = {
+    "left-arrow, h, a : moves cursor to left",
+    "down-arrow, j, s : moves cursor to down",
+    "up-arrow,   k, w : moves cursor to up",
+    "right-arrow,l, d : moves cursor to left",
+    "5l, 3j, ...      : slide that many tiles at once",
+    "u                : undo move",
+    "r                : redo move",
+    "i                : show a hint",
+    "p                : toggle auto-play",
+    "t                : toggle frame timings",
+    "[, ]             : step back, forward in time",
+    "g                : jump to a step of the game",
+    "qq               : save & exit",
+    "Q                : exit without saving",
+    "Enter            : choose selected item",
+    "?                : shows this window",
+    " ",
+    "  Press any key to close this window",
+  };
+
+  int h = sizeof(help_msg) / sizeof(char*);
+  int w = strlen(help_msg[0]);
+  refresh();
+  WINDOW* usage_win = newwin(h + 2, w + 3, CENTER_Y(h), CENTER_X(w));
+  box(usage_win, 0, 0);
+
+  for (int i = 0; i < h; i++) {
+    mvwprintw(usage_win,i + 1, 1, "%s", help_msg[i]);
+  }
+
+  wrefresh(usage_win);
+  getch();
+  werase(usage_win);
+  wborder(usage_win, ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ');
+  wrefresh(usage_win);
+  delwin(usage_win);
+}
+
+// draws the leaderboard of a finished game, best first. the row of the
+// player that just finished is highlighted.
+void draw_leaderboard(const struct leaderboard_record* records, size_t read_records_count, uint16_t game_mode,
+                      uint16_t order, const char* player_name, uint16_t moves) {
+  if (read_records_count) {
+    int rank = 0;
+    for (int i = 0; i < read_records_count; i++) {
+      if (strcmp(records[i].player_name, player_name) == 0 && records[i].moves == moves) {
+        rank = i;
+        break;
+      }
+    }
+
+    char *mode;
+    switch (game_mode) {
+      case mode_easy: mode = "Easy"; break;
+      case mode_normal: mode = "Normal"; break;
+      case mode_hard: mode = "Hard"; break;
+      default: mode = "Custom"; break; 
+    }
+
+    erase();
+    char* template = "#  Moves   Player          Time     ";
+    int y = CENTER_Y(read_records_count + 3);
+    int x = CENTER_X(strlen("6. 35	   hariii          12-03-2025 21:36:12"));
+
+    attron(A_BOLD);
+    mvprintw(y++, x, "Congrats %s! you are #%d", player_name, rank + 1);
+    attroff(A_BOLD);
+    y++;
+    attron(A_DIM);
+    mvprintw(y++, x, "Leaderboard (%s){%dx%d}", mode, order, order);
+    attroff(A_DIM);
+    mvchgat(y - 1, x, strlen("Leaderboard"), A_UNDERLINE, 0, NULL);
+    mvprintw(y++, x, "%s", template);
+
+    struct tm *ctime;
+    for (int i = 0; i < read_records_count; i++) {
+      ctime = localtime(&records[i].time);
+      mvprintw(y, x, "%d. %d", i + 1, records[i].moves);
+      mvprintw(y, x + 11, "%s", records[i].player_name);
+      mvprintw(y, x + 26,
+               " %02d-%02d-%4d %02d:%02d:%02d",
+               ctime->tm_mday,
+               ctime->tm_mon + 1,
+               ctime->tm_year + 1900,
+               ctime->tm_hour,
+               ctime->tm_min,
+               ctime->tm_sec
+             );
+      if (i == rank) {
+        mvchgat(y, x, -1, A_BOLD, 0, NULL);
+      }
+      y++;
+    }
+  }
+}
+
+// saves new entry to csv file and display leaderboard.
+// finished is the time the game was won, it also names the replay of the game.
+void display_leaderboards(const struct game_state* gs, char* name, time_t finished) {
+  csv_arena = arena_init(1024); // initializes new arena context
+  if (csv_arena == NULL) return;
+  char* player_name = strdup(name);
+  struct leaderboard_record new_record = leader_board_init(gs->order, moves_used(gs), player_name, finished);
+  struct leaderboard_record *records = arena_alloc(csv_arena, sizeof(struct leaderboard_record) * LEADERBOARD_ENTRIES);
+  size_t read_records_count = submit_record(&new_record, gs->mode, records);
+  draw_leaderboard(records, read_records_count, gs->mode, gs->order, player_name, new_record.moves);
+  free(player_name);
+  arena_free(csv_arena);
+}
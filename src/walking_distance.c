@@ -0,0 +1,234 @@
+/*
+Walking distance heuristic for 4x4 boards.
+
+Forget which column every tile is in and only keep, for each row, how
+many of its tiles belong to each goal row. Moving the void up or down
+swaps a tile between two neighbouring rows, so these count matrices form
+a small graph of their own (24964 states). The distance of a count
+matrix to the goal matrix in that graph is a lower bound on the number
+of vertical moves needed to solve the board. Doing the same for columns
+bounds the horizontal moves, and the sum of both is the walking distance.
+
+The same table serves both directions, since the goal of the column
+counts looks exactly like the goal of the row counts. Every state also
+stores its neighbours (which state the void moving up or down with a tile
+of goal row g leads to), so a search can update the heuristic in O(1).
+
+The table is generated with a breadth-first search and cached in
+WALKING_DISTANCE_FILE. A cached table is only used if it has the current
+version, the exact size and entries that hang together (see wd_table_ok()),
+anything else is generated again and overwritten.
+*/
+
+#pragma once
+
+#include <pthread.h>
+#include "../lib/uni-void.c"
+
+#define WD_ORDER 4
+#define WD_STATES 24964
+#define WD_MAGIC 0x31445755 // "UWD1"
+#define WD_VERSION 2 // bumped whenever the layout of the file changes
+#define WD_SEEN_SLOTS (1 << 16)
+
+struct wd_table {
+  uint64_t keys[WD_STATES]; // packed count matrices, sorted
+  uint8_t dist[WD_STATES];
+  // link[state][dir][g] is the state reached when the void moves up (dir 0)
+  // or down (dir 1) and swaps with a tile that belongs to goal row g.
+  uint16_t link[WD_STATES][2][WD_ORDER];
+};
+
+static struct wd_table* wd;
+static pthread_once_t wd_once = PTHREAD_ONCE_INIT;
+
+// packs a count matrix into 48 bits, 3 bits a count.
+static uint64_t wd_pack(uint8_t counts[WD_ORDER][WD_ORDER]) {
+  uint64_t key = 0;
+  for (int r = 0; r < WD_ORDER; r++) {
+    for (int g = 0; g < WD_ORDER; g++) key = key << 3 | counts[r][g];
+  }
+  return key;
+}
+
+static void wd_unpack(uint64_t key, uint8_t counts[WD_ORDER][WD_ORDER]) {
+  for (int r = WD_ORDER - 1; r >= 0; r--) {
+    for (int g = WD_ORDER - 1; g >= 0; g--) {
+      counts[r][g] = key & 7;
+      key >>= 3;
+    }
+  }
+}
+
+// returns the index of key in the table, -1 if it isn't there.
+static int wd_find(const uint64_t* keys, int count, uint64_t key) {
+  int lo = 0, hi = count - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    if (keys[mid] == key) return mid;
+    if (keys[mid] < key) lo = mid + 1; else hi = mid - 1;
+  }
+  return -1;
+}
+
+static int wd_compare(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+// the row of the void is the one holding one tile less.
+static int wd_void_row(uint8_t counts[WD_ORDER][WD_ORDER]) {
+  for (int r = 0; r < WD_ORDER; r++) {
+    int sum = 0;
+    for (int g = 0; g < WD_ORDER; g++) sum += counts[r][g];
+    if (sum < WD_ORDER) return r;
+  }
+  return -1;
+}
+
+// the state after the void leaves row r for row r + step with a tile of goal row g.
+static uint64_t wd_step(uint64_t key, int step, int g) {
+  uint8_t counts[WD_ORDER][WD_ORDER];
+  wd_unpack(key, counts);
+  int r = wd_void_row(counts);
+  if (r + step < 0 || r + step >= WD_ORDER || counts[r + step][g] == 0) return 0;
+  counts[r + step][g]--;
+  counts[r][g]++;
+  return wd_pack(counts);
+}
+
+// adds key to the set. returns false if it was already there.
+static bool wd_insert(uint64_t* seen, uint64_t key) {
+  uint32_t slot = (key * 0x9e3779b97f4a7c15ull) >> 48;
+  while (seen[slot] != 0) {
+    if (seen[slot] == key) return false;
+    slot = (slot + 1) & (WD_SEEN_SLOTS - 1);
+  }
+  seen[slot] = key;
+  return true;
+}
+
+// builds the table with a breadth-first search from the goal.
+static bool wd_generate(struct wd_table* t) {
+  uint8_t goal[WD_ORDER][WD_ORDER] = { 0 };
+  for (int r = 0; r < WD_ORDER; r++) goal[r][r] = (r == WD_ORDER - 1) ? WD_ORDER - 1 : WD_ORDER;
+
+  // the bfs runs on an unsorted queue with a small hash set to spot states
+  // already seen. the sorted table is built from the queue afterwards.
+  uint64_t* queue = malloc(sizeof(uint64_t) * WD_SEEN_SLOTS / 2);
+  uint8_t* dist = malloc(WD_SEEN_SLOTS / 2);
+  uint64_t* seen = calloc(WD_SEEN_SLOTS, sizeof(uint64_t));
+  int head = 0, tail = 0;
+  queue[tail] = wd_pack(goal);
+  dist[tail++] = 0;
+  wd_insert(seen, queue[0]);
+  while (head < tail) {
+    uint64_t key = queue[head];
+    for (int step = -1; step <= 1; step += 2) {
+      for (int g = 0; g < WD_ORDER; g++) {
+        uint64_t next = wd_step(key, step, g);
+        if (next == 0 || !wd_insert(seen, next)) continue;
+        if (tail == WD_SEEN_SLOTS / 2) break; // can't happen, checked below
+        queue[tail] = next;
+        dist[tail++] = dist[head] + 1;
+      }
+    }
+    head++;
+  }
+  free(seen);
+  if (tail != WD_STATES) {
+    free(queue);
+    free(dist);
+    return false;
+  }
+
+  memcpy(t->keys, queue, sizeof(uint64_t) * WD_STATES);
+  qsort(t->keys, WD_STATES, sizeof(uint64_t), wd_compare);
+  for (int i = 0; i < WD_STATES; i++) {
+    int idx = wd_find(t->keys, WD_STATES, queue[i]);
+    t->dist[idx] = dist[i];
+  }
+  for (int i = 0; i < WD_STATES; i++) {
+    for (int dir = 0; dir < 2; dir++) {
+      for (int g = 0; g < WD_ORDER; g++) {
+        uint64_t next = wd_step(t->keys[i], dir == 0 ? -1 : 1, g);
+        t->link[i][dir][g] = (next == 0) ? 0 : wd_find(t->keys, WD_STATES, next);
+      }
+    }
+  }
+  free(queue);
+  free(dist);
+  return true;
+}
+
+// true if the table read from a file can be trusted by the solvers: keys
+// sorted (wd_find() bisects them), the goal at distance 0, every link in
+// range and one step away from the state it leaves.
+static bool wd_table_ok(const struct wd_table* t) {
+  uint8_t goal[WD_ORDER][WD_ORDER] = { 0 };
+  for (int r = 0; r < WD_ORDER; r++) goal[r][r] = (r == WD_ORDER - 1) ? WD_ORDER - 1 : WD_ORDER;
+  int at_goal = wd_find(t->keys, WD_STATES, wd_pack(goal));
+  if (at_goal < 0 || t->dist[at_goal] != 0) return false;
+  for (int i = 0; i < WD_STATES; i++) {
+    if (i > 0 && t->keys[i] <= t->keys[i - 1]) return false;
+    for (int dir = 0; dir < 2; dir++) {
+      for (int g = 0; g < WD_ORDER; g++) {
+        uint16_t next = t->link[i][dir][g];
+        if (next >= WD_STATES || (next != 0 && abs(t->dist[next] - t->dist[i]) != 1)) return false;
+      }
+    }
+  }
+  return true;
+}
+
+static bool wd_load(struct wd_table* t, const char* filename) {
+  FILE* fp = fopen(filename, "rb");
+  if (fp == NULL) return false;
+  uint32_t header[2];
+  bool ok = fread(header, sizeof(header), 1, fp) == 1 && header[0] == WD_MAGIC && header[1] == WD_VERSION &&
+            fread(t, sizeof(struct wd_table), 1, fp) == 1 &&
+            fgetc(fp) == EOF; // a file longer than the table isn't one
+  fclose(fp);
+  return ok && wd_table_ok(t);
+}
+
+static void wd_save(const struct wd_table* t, const char* filename) {
+  FILE* fp = fopen(filename, "wb");
+  if (fp == NULL) return; // caching is optional
+  uint32_t header[2] = { WD_MAGIC, WD_VERSION };
+  fwrite(header, sizeof(header), 1, fp);
+  fwrite(t, sizeof(struct wd_table), 1, fp);
+  fclose(fp);
+}
+
+static void wd_init() {
+  struct wd_table* t = malloc(sizeof(struct wd_table));
+  if (t == NULL) return;
+  if (!wd_load(t, WALKING_DISTANCE_FILE)) {
+    if (!wd_generate(t)) {
+      free(t);
+      return;
+    }
+    wd_save(t, WALKING_DISTANCE_FILE);
+  }
+  wd = t;
+}
+
+// returns the table, loading or generating it on first use. NULL if out of memory.
+const struct wd_table* wd_table_get() {
+  pthread_once(&wd_once, wd_init);
+  return wd;
+}
+
+// state of the row counts (or column counts when by_column) of a 4x4 board.
+int wd_index(const struct wd_table* t, const uint8_t* tiles, bool by_column) {
+  uint8_t counts[WD_ORDER][WD_ORDER] = { 0 };
+  for (int i = 0; i < WD_ORDER * WD_ORDER; i++) {
+    int tile = tiles[i];
+    if (tile == 0) continue;
+    int line = by_column ? i % WD_ORDER : i / WD_ORDER;
+    int goal = by_column ? (tile - 1) % WD_ORDER : (tile - 1) / WD_ORDER;
+    counts[line][goal]++;
+  }
+  return wd_find(t->keys, WD_STATES, wd_pack(counts));
+}
@@ -0,0 +1,29 @@
+/*
+Zobrist hashing of boards.
+
+Every (tile, cell) pair has a random 64-bit key and the hash of a board
+is the xor of the keys of all its tiles. Sliding a tile only touches two
+cells, so the hash can be updated in O(1) when a move is made.
+
+Instead of a key table (which would need orders^4 entries), keys are
+derived from (tile, cell) with the splitmix64 finalizer. They are just as
+well distributed, need no memory and are the same in every process.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// returns the key of tile sitting on cell.
+static inline uint64_t zobrist_key(uint32_t tile, uint32_t cell) {
+  uint64_t z = ((uint64_t)tile << 32 | cell) + 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// returns the change in hash when tile slides from one cell to the other,
+// swapping places with the void-tile.
+static inline uint64_t zobrist_slide(uint32_t tile, uint32_t from, uint32_t to) {
+  return zobrist_key(tile, from) ^ zobrist_key(tile, to) ^ zobrist_key(0, from) ^ zobrist_key(0, to);
+}